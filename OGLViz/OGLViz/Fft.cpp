@@ -6,6 +6,7 @@
 //------------------------------------
 #include "windows.h"
 #include "headers\\fft.hpp"
+#include "headers\\trace.hpp"
 #include <cstring>
 #include <iostream>
 //#include "recorder.h" remove dis shit
@@ -89,6 +90,7 @@ Fft::~Fft()
 
 void Fft::CopyIn (SampleIter &iter)
 {
+    TRACE_SCOPE("Fft::CopyIn");
     int cSample = iter.Count();
     if (cSample > _Points)
         return;
@@ -108,6 +110,23 @@ void Fft::CopyIn (SampleIter &iter)
         PutAt (i, _aTape[i]);
 }
 
+void Fft::CopyIn (const float* samples, int cSample)
+{
+    TRACE_SCOPE("Fft::CopyIn");
+    if (cSample > _Points)
+        return;
+
+    memmove (_aTape, &_aTape[cSample],
+              (_Points - cSample) * sizeof(double));
+    int iTail  = _Points - cSample;
+    for (int i = 0; i < cSample; i++)
+    {
+        _aTape [i + iTail] = (double) samples[i];
+    }
+    for (int i = 0; i < _Points; i++)
+        PutAt (i, _aTape[i]);
+}
+
 //
 //               0   1   2   3   4   5   6   7
 //  level   1
@@ -131,6 +150,7 @@ void Fft::CopyIn (SampleIter &iter)
 
 void Fft::Transform ()
 {
+    TRACE_SCOPE("Fft::Transform");
     // step = 2 ^ (level-1)
     // increm = 2 ^ level;
     int step = 1;
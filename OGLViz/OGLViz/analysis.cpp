@@ -0,0 +1,95 @@
+#include <windows.h>
+#include <stdio.h>
+#include <chrono>
+
+#include "headers\\fft.hpp"
+#include "headers\\bufferpool.hpp"
+#include "headers\\features.hpp"
+#include "headers\\stereo.hpp"
+#include "headers\\loudness.hpp"
+#include "headers\\spectrumbus.hpp"
+#include "headers\\netstream.hpp"
+#include "headers\\analysis.hpp"
+#include "headers\\trace.hpp"
+
+static const int SAMPLE_RATE = 44100;
+static const int FFT_POINTS = 4096;
+static const int CAPTURE_SAMPLES = 1024;
+static const double LATENCY_BUDGET_MS = 50.0;
+
+static volatile bool running = true;
+
+static BOOL WINAPI onConsoleCtrl(DWORD) {
+	running = false;
+	return TRUE;
+}
+
+static uint64_t nowNs() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int runAnalysisPublisher(const char* busName, const char* multicastGroup) {
+	SpectrumBusWriter bus;
+	if (busName != NULL && !bus.Create(busName)) {
+		fprintf(stderr, "Cannot create spectrum bus '%s'\n", busName);
+		return -1;
+	}
+	SpectrumSender sender;
+	if (multicastGroup != NULL && !sender.Open(multicastGroup)) {
+		fprintf(stderr, "Cannot send to multicast group '%s'\n", multicastGroup);
+		return -1;
+	}
+	// without a bus the frame is built here and only sent
+	static AnalysisFrame localFrame;
+
+	Event bufferEvent;
+	RecorderS16 recorder(CAPTURE_SAMPLES, SAMPLE_RATE);
+	Fft fft(FFT_POINTS, SAMPLE_RATE);
+	FeatureExtractor features(FFT_POINTS, SAMPLE_RATE);
+	static StereoAnalyzer stereo;
+	static LoudnessMeter loudness(SAMPLE_RATE);
+	// de-interleaved capture, sized for the largest buffer the pool may pick
+	static float left[FFT_POINTS];
+	static float right[FFT_POINTS];
+	BufferPoolController pool(LATENCY_BUDGET_MS, 256, FFT_POINTS);
+
+	if (!recorder.Start(bufferEvent))
+		return -1;
+	SetConsoleCtrlHandler(onConsoleCtrl, TRUE);
+	fprintf(stdout, "Publishing analysis frames on %s%s%s, Ctrl+C to stop\n",
+		busName != NULL ? busName : "", busName != NULL && multicastGroup != NULL ? " and " : "",
+		multicastGroup != NULL ? multicastGroup : "");
+
+	TRACE_THREAD_NAME("analysis");
+	while (running) {
+		{
+			TRACE_SCOPE("wait for capture");
+			bufferEvent.Wait();
+		}
+		while (recorder.IsBufferDone()) {
+			TRACE_SCOPE("analyse buffer");
+			uint64_t captureTime = nowNs();
+			SampleIter iter(recorder);
+			fft.CopyIn(iter);
+			fft.Transform();
+			AnalysisFrame& frame = busName != NULL ? bus.Begin() : localFrame;
+			features.Process(fft, captureTime, frame);
+			recorder.CopyChannels(left, right);
+			stereo.Process(left, right, recorder.SampleCount(), frame);
+			loudness.Process(left, right, recorder.SampleCount(), frame);
+			{
+				TRACE_SCOPE("publish");
+				if (multicastGroup != NULL)
+					sender.Send(frame);
+				if (busName != NULL)
+					bus.Commit();
+			}
+			recorder.BufferDone();
+			pool.Update(recorder);
+		}
+	}
+
+	recorder.Stop();
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "headers\\audiosource.hpp"
+
+static const double PI = 3.14159265358979323846;
+
+AudioSource::AudioSource()
+	: _sampleRate(SYNTHETIC_RATE)
+{
+}
+
+bool AudioSource::Open(const char* wavPath)
+{
+	_left.clear();
+	_right.clear();
+	_sampleRate = SYNTHETIC_RATE;
+	if (wavPath == NULL)
+		return true;
+	return LoadWav(wavPath);
+}
+
+static uint32_t readLe32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t readLe16(const unsigned char* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+bool AudioSource::LoadWav(const char* path)
+{
+	FILE* file = NULL;
+	if (fopen_s(&file, path, "rb") != 0 || file == NULL) {
+		fprintf(stderr, "Cannot open %s\n", path);
+		return false;
+	}
+	unsigned char riff[12];
+	if (fread(riff, 1, sizeof(riff), file) != sizeof(riff) ||
+		memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+		fprintf(stderr, "%s is not a WAV file\n", path);
+		fclose(file);
+		return false;
+	}
+
+	// walk the chunks until both "fmt " and "data" were seen
+	int channels = 0;
+	int bits = 0;
+	bool haveFormat = false;
+	std::vector<short> pcm;
+	unsigned char chunk[8];
+	while (fread(chunk, 1, sizeof(chunk), file) == sizeof(chunk)) {
+		uint32_t size = readLe32(chunk + 4);
+		if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+			unsigned char format[16];
+			if (fread(format, 1, sizeof(format), file) != sizeof(format))
+				break;
+			channels = readLe16(format + 2);
+			_sampleRate = (long)readLe32(format + 4);
+			bits = readLe16(format + 14);
+			haveFormat = readLe16(format) == 1 && bits == 16 && (channels == 1 || channels == 2);
+			fseek(file, (long)(size - 16 + (size & 1)), SEEK_CUR);
+		}
+		else if (memcmp(chunk, "data", 4) == 0 && haveFormat) {
+			pcm.resize(size / sizeof(short));
+			pcm.resize(fread(pcm.data(), sizeof(short), pcm.size(), file));
+			break;
+		}
+		else {
+			// chunks are word aligned
+			fseek(file, (long)(size + (size & 1)), SEEK_CUR);
+		}
+	}
+	fclose(file);
+	if (!haveFormat) {
+		fprintf(stderr, "%s: only 16-bit PCM mono or stereo is supported\n", path);
+		return false;
+	}
+
+	size_t frames = pcm.size() / channels;
+	if (frames == 0) {
+		fprintf(stderr, "%s has no samples\n", path);
+		return false;
+	}
+	const float scale = 1.0f / 32768.0f;
+	_left.resize(frames);
+	_right.resize(frames);
+	for (size_t i = 0; i < frames; i++) {
+		_left[i] = pcm[i * channels] * scale;
+		_right[i] = pcm[i * channels + channels - 1] * scale;
+	}
+	printf("Audio: %s, %d channel(s), %ld Hz, %.1f s\n", path, channels, _sampleRate,
+		(double)frames / _sampleRate);
+	return true;
+}
+
+void AudioSource::Read(uint64_t first, int count, float* left, float* right) const
+{
+	if (Synthetic()) {
+		for (int i = 0; i < count; i++)
+			Synthesize(first + i, left[i], right[i]);
+		return;
+	}
+	size_t length = _left.size();
+	size_t position = (size_t)(first % length);
+	for (int i = 0; i < count; i++) {
+		left[i] = _left[position];
+		right[i] = _right[position];
+		if (++position == length)
+			position = 0;
+	}
+}
+
+// Every term is a function of the position alone; the noise is a hash of
+// it rather than a running generator, so any sample can be computed first.
+void AudioSource::Synthesize(uint64_t position, float& left, float& right) const
+{
+	double t = (double)position / _sampleRate;
+	double beat = fmod(t, 0.5);
+
+	// kick: 55 Hz body dropping from 150 Hz, 120 ms decay
+	double kickPhase = 2 * PI * (55.0 * beat + 95.0 * 0.03 * (1.0 - exp(-beat / 0.03)));
+	double kick = sin(kickPhase) * exp(-beat / 0.12);
+
+	// bass sweeping 40 .. 160 Hz over 8 s
+	double sweep = 40.0 * pow(4.0, 0.5 - 0.5 * cos(2 * PI * t / 8.0));
+	double bass = 0.3 * sin(2 * PI * sweep * t);
+
+	// hats on the off beats
+	double offBeat = fmod(t + 0.25, 0.5);
+	uint32_t hash = (uint32_t)position * 2654435761u;
+	hash ^= hash >> 15;
+	hash *= 2246822519u;
+	hash ^= hash >> 13;
+	double noise = (hash & 0xffff) / 32768.0 - 1.0;
+	double hat = 0.15 * noise * exp(-offBeat / 0.02);
+
+	// pad: a fifth apart, detuned and panned
+	double padL = 0.12 * sin(2 * PI * 220.0 * t) + 0.08 * sin(2 * PI * 330.5 * t);
+	double padR = 0.12 * sin(2 * PI * 220.7 * t) + 0.08 * sin(2 * PI * 329.5 * t);
+
+	double mid = 0.6 * kick + bass + hat;
+	left = (float)(0.5 * (mid + padL));
+	right = (float)(0.5 * (mid + padR));
+}
@@ -0,0 +1,69 @@
+#include "windows.h"
+#include "headers\\fft.hpp"
+#include "headers\\bufferpool.hpp"
+
+BufferPoolController::BufferPoolController(double latencyBudgetMs, int minSamples, int maxSamples)
+    : _budgetMs(latencyBudgetMs),
+    _minSamples(minSamples),
+    _maxSamples(maxSamples),
+    _peakLag(0),
+    _cObserved(0),
+    _cCalm(0)
+{
+}
+
+// Largest power of two per buffer that keeps (peak lag + 1) buffers within budget
+int BufferPoolController::TargetSamples(Recorder const& recorder) const
+{
+    double budgetSamples = _budgetMs * recorder.SamplesPerSecond() / 1000.0;
+    double perBuffer = budgetSamples / (_peakLag + 1);
+    int cSamples = _minSamples;
+    while (cSamples * 2 <= perBuffer && cSamples * 2 <= _maxSamples)
+        cSamples *= 2;
+    return cSamples;
+}
+
+bool BufferPoolController::Update(Recorder& recorder)
+{
+    int lag = recorder.PendingBuffers();
+    int numBuf = recorder.BufferCount();
+    int cSamples = recorder.SampleCount();
+    if (lag > _peakLag)
+        _peakLag = lag;
+    _cObserved++;
+
+    // about to overrun: grow right away, keep the sample count
+    if (lag >= numBuf - 1 && numBuf < Recorder::MAX_NUM_BUF)
+    {
+        _peakLag = 0;
+        _cObserved = 0;
+        _cCalm = 0;
+        return recorder.Resize(numBuf * 2, cSamples) == TRUE;
+    }
+
+    if (_cObserved < WINDOW)
+        return false;
+
+    int newSamples = TargetSamples(recorder);
+    int newNumBuf = numBuf;
+    // smaller buffers to hold the budget apply at once, anything looser waits to settle
+    _cCalm = newSamples < cSamples ? 0 : _cCalm + 1;
+    bool settled = _cCalm >= SETTLE_WINDOWS;
+    if (!settled && newSamples > cSamples)
+        newSamples = cSamples;
+    // plenty of headroom: keep twice the worst lag we have seen
+    if (settled && _peakLag * 4 <= numBuf)
+    {
+        newNumBuf = numBuf / 2;
+        if (newNumBuf < 2 * (_peakLag + 1))
+            newNumBuf = 2 * (_peakLag + 1);
+    }
+    _peakLag = 0;
+    _cObserved = 0;
+    if (settled)
+        _cCalm = 0;
+
+    if (newNumBuf == numBuf && newSamples == cSamples)
+        return false;
+    return recorder.Resize(newNumBuf, newSamples) == TRUE;
+}
@@ -28,32 +28,25 @@ mat4 getProjectionMatrix() {
 * ^^^ by defualt before any transforms
 */
 
-// Initial position : on +Z
-vec3 position = vec3(0, 0, 5);
-// Initial horizontal angle : toward -Z
-float horizontalAngle = 3.14f;
-// Initial vertical angle : none
-float verticalAngle = 0.0f;
-// Initial Field of View
-float initialFoV = 45.0f;
+// Initial position : on +Z, toward -Z, no vertical angle, 45 degree field of view
+CameraState initialCamera() {
+	CameraState camera;
+	camera.position = vec3(0, 0, 5);
+	camera.horizontalAngle = 3.14f;
+	camera.verticalAngle = 0.0f;
+	camera.fov = 45.0f;
+	return camera;
+}
 
 float speed = 3.0f; // 3 units / second
 float mouseSpeed = 0.005f;
 
 
-
-void computeMatricesFromInputs() {
+ControlInput readControlInput() {
 	int w;
 	int h;
 	glfwGetWindowSize(window, &w, &h);
 
-	// glfwGetTime is called only once, the first time this function is called
-	static double lastTime = glfwGetTime();
-
-	// Compute time difference between current and last frame
-	double currentTime = glfwGetTime();
-	float deltaTime = float(currentTime - lastTime);
-
 	// Get mouse position
 	double xpos, ypos;
 	glfwGetCursorPos(window, &xpos, &ypos);
@@ -61,56 +54,105 @@ void computeMatricesFromInputs() {
 	// Reset mouse position for next frame
 	glfwSetCursorPos(window, w / 2.0, h / 2.0);
 
-	// Compute new orientation
-	horizontalAngle += mouseSpeed * float(w / 2.0 - xpos);
-	verticalAngle += mouseSpeed * float(h / 2.0 - ypos);
-	verticalAngle = clamp(verticalAngle, -3.14f/4.0f, 3.14f/4.0f);
-
-	// Direction : Spherical coordinates to Cartesian coordinates conversion
-	vec3 direction(
-		cos(verticalAngle) * sin(horizontalAngle),
-		sin(verticalAngle),
-		cos(verticalAngle) * cos(horizontalAngle)
+	ControlInput input;
+	input.mouseX = float(w / 2.0 - xpos);
+	input.mouseY = float(h / 2.0 - ypos);
+	input.forward = glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS;
+	input.backward = glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS;
+	input.right = glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS;
+	input.left = glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS;
+	return input;
+}
+
+// Direction : Spherical coordinates to Cartesian coordinates conversion
+static vec3 cameraDirection(CameraState const& camera) {
+	return vec3(
+		cos(camera.verticalAngle) * sin(camera.horizontalAngle),
+		sin(camera.verticalAngle),
+		cos(camera.verticalAngle) * cos(camera.horizontalAngle)
 	);
+}
 
-	// Right vector
-	vec3 right = vec3(
-		sin(horizontalAngle - 3.14f / 2.0f),
+// Right vector
+static vec3 cameraRight(CameraState const& camera) {
+	return vec3(
+		sin(camera.horizontalAngle - 3.14f / 2.0f),
 		0,
-		cos(horizontalAngle - 3.14f / 2.0f)
+		cos(camera.horizontalAngle - 3.14f / 2.0f)
 	);
+}
 
-	// Up vector
-	vec3 up = cross(right, direction);
+void stepCamera(CameraState& camera, ControlInput const& input, float deltaTime) {
+	// Compute new orientation
+	camera.horizontalAngle += mouseSpeed * input.mouseX;
+	camera.verticalAngle += mouseSpeed * input.mouseY;
+	camera.verticalAngle = clamp(camera.verticalAngle, -3.14f/4.0f, 3.14f/4.0f);
+
+	vec3 direction = cameraDirection(camera);
+	vec3 right = cameraRight(camera);
 
 	// Move forward
-	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-		position += direction * deltaTime * speed;
+	if (input.forward) {
+		camera.position += direction * deltaTime * speed;
 	}
 	// Move backward
-	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-		position -= direction * deltaTime * speed;
+	if (input.backward) {
+		camera.position -= direction * deltaTime * speed;
 	}
 	// Strafe right
-	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-		position += right * deltaTime * speed;
+	if (input.right) {
+		camera.position += right * deltaTime * speed;
 	}
 	// Strafe left
-	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-		position -= right * deltaTime * speed;
+	if (input.left) {
+		camera.position -= right * deltaTime * speed;
 	}
+}
 
-	float FoV = initialFoV;// - 5 * glfwGetMouseWheel(); // Now GLFW 3 requires setting up a callback for this. It's a bit too complicated for this beginner's tutorial, so it's disabled instead.
+// angles are never wrapped, so a plain lerp takes the short way
+CameraState lerpCamera(CameraState const& a, CameraState const& b, float t) {
+	CameraState camera;
+	camera.position = mix(a.position, b.position, t);
+	camera.horizontalAngle = mix(a.horizontalAngle, b.horizontalAngle, t);
+	camera.verticalAngle = mix(a.verticalAngle, b.verticalAngle, t);
+	camera.fov = mix(a.fov, b.fov, t);
+	return camera;
+}
+
+// Projection matrix : Field of View, display range : 0.1 unit <-> 100 units
+mat4 cameraProjection(CameraState const& camera, float aspect) {
+	return perspective(radians(camera.fov), aspect, 0.1f, 100.0f);
+}
 
-	// Projection matrix : 45 Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units
-	ProjectionMatrix = perspective(radians(FoV), 4.0f / 3.0f, 0.1f, 100.0f);
-	// Camera matrix
-	ViewMatrix = lookAt(
-		position,           // Camera is here
-		position + direction, // and looks here : at the same position, plus "direction"
+// Camera matrix
+mat4 cameraView(CameraState const& camera) {
+	vec3 direction = cameraDirection(camera);
+	// Up vector
+	vec3 up = cross(cameraRight(camera), direction);
+	return lookAt(
+		camera.position,           // Camera is here
+		camera.position + direction, // and looks here : at the same position, plus "direction"
 		up                  // Head is up (set to 0,-1,0 to look upside-down)
 	);
+}
+
+// Input applied once per rendered frame, for callers without a Simulation
+void computeMatricesFromInputs() {
+	static CameraState camera = initialCamera();
+
+	// glfwGetTime is called only once, the first time this function is called
+	static double lastTime = glfwGetTime();
+
+	// Compute time difference between current and last frame
+	double currentTime = glfwGetTime();
+	float deltaTime = float(currentTime - lastTime);
+
+	stepCamera(camera, readControlInput(), deltaTime);
+
+	// 4:3 ratio
+	ProjectionMatrix = cameraProjection(camera, 4.0f / 3.0f);
+	ViewMatrix = cameraView(camera);
 
 	// For the next frame, the "last time" will be "now"
 	lastTime = currentTime;
-}
\ No newline at end of file
+}
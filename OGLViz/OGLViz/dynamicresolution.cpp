@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <math.h>
+
+#include <GL\\glew.h>
+
+#include "headers\\shader.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\dynamicresolution.hpp"
+
+// Hysteresis band and aim, as fractions of the budget
+static const double LOW_FRACTION = 0.70;
+static const double HIGH_FRACTION = 0.95;
+static const double TARGET_FRACTION = 0.85;
+// weight of a new GPU time in the smoothed one
+static const double SMOOTHING = 0.1;
+
+DynamicResolution::DynamicResolution()
+	: _program(0), _sourceScaleID(-1), _texelSizeID(-1), _sourceMaxID(-1), _sharpnessID(-1),
+	_vao(0), _framebuffer(0), _color(0), _depth(0), _allocatedWidth(0), _allocatedHeight(0),
+	_windowWidth(0), _windowHeight(0), _width(0), _height(0),
+	_budgetMs(16.6), _minScale(0.5f), _maxScale(1.0f), _sharpness(0.0f), _scale(1.0f),
+	_smoothedMs(-1.0), _cooldown(0), _changes(0), _frame(0)
+{
+	for (int i = 0; i < QUERY_FRAMES; i++) {
+		_queries[i][0] = _queries[i][1] = 0;
+		_pending[i] = false;
+		_issuedScale[i] = 0.0f;
+	}
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	glDeleteQueries(QUERY_FRAMES * 2, &_queries[0][0]);
+	glDeleteFramebuffers(1, &_framebuffer);
+	glDeleteTextures(1, &_color);
+	glDeleteRenderbuffers(1, &_depth);
+	glDeleteVertexArrays(1, &_vao);
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+}
+
+bool DynamicResolution::Init(double budgetMs, float minScale, float maxScale, float sharpness,
+	const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	GLuint program = LoadShaders(vertexShaderPath, fragmentShaderPath);
+	if (program == 0)
+		return false;
+	SetProgram(program);
+	_budgetMs = budgetMs;
+	_minScale = minScale;
+	_maxScale = maxScale;
+	_sharpness = sharpness;
+	_scale = maxScale;
+
+	glGenQueries(QUERY_FRAMES * 2, &_queries[0][0]);
+	glGenFramebuffers(1, &_framebuffer);
+	glGenTextures(1, &_color);
+	glGenRenderbuffers(1, &_depth);
+	// the quad comes from gl_VertexID, the VAO is only there for core profile
+	glGenVertexArrays(1, &_vao);
+	return glGetError() == GL_NO_ERROR;
+}
+
+void DynamicResolution::SetProgram(GLuint program)
+{
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+	_program = program;
+	_sourceScaleID = glGetUniformLocation(_program, "sourceScale");
+	_texelSizeID = glGetUniformLocation(_program, "texelSize");
+	_sourceMaxID = glGetUniformLocation(_program, "sourceMax");
+	_sharpnessID = glGetUniformLocation(_program, "sharpness");
+}
+
+// full window size, the scale only picks how much of it is drawn
+bool DynamicResolution::Allocate(int width, int height)
+{
+	glState().BindTexture(0, _color);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindRenderbuffer(GL_RENDERBUFFER, _depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _color, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Dynamic resolution target incomplete (0x%x)\n", status);
+		return false;
+	}
+	_allocatedWidth = width;
+	_allocatedHeight = height;
+	return true;
+}
+
+// the slot about to be reused was issued QUERY_FRAMES ago; take its result
+// if the GPU got there, otherwise let it go rather than wait. A frame drawn
+// before the last scale change says nothing about the current scale.
+void DynamicResolution::Collect()
+{
+	int slot = _frame % QUERY_FRAMES;
+	if (!_pending[slot])
+		return;
+	_pending[slot] = false;
+	if (_issuedScale[slot] != _scale)
+		return;
+	GLint available = 0;
+	glGetQueryObjectiv(_queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+	GLuint64 begin = 0, end = 0;
+	glGetQueryObjectui64v(_queries[slot][0], GL_QUERY_RESULT, &begin);
+	glGetQueryObjectui64v(_queries[slot][1], GL_QUERY_RESULT, &end);
+	double ms = (end - begin) / 1e6;
+	_smoothedMs = _smoothedMs < 0 ? ms : _smoothedMs + (ms - _smoothedMs) * SMOOTHING;
+	Control();
+}
+
+void DynamicResolution::Control()
+{
+	if (_cooldown > 0) {
+		_cooldown--;
+		return;
+	}
+	bool over = _smoothedMs > _budgetMs * HIGH_FRACTION && _scale > _minScale;
+	bool under = _smoothedMs < _budgetMs * LOW_FRACTION && _scale < _maxScale;
+	if (!over && !under)
+		return;
+	double scale = _scale * sqrt(_budgetMs * TARGET_FRACTION / _smoothedMs);
+	scale = floor(scale * SCALE_STEPS + 0.5) / SCALE_STEPS;
+	scale = scale < _minScale ? _minScale : (scale > _maxScale ? _maxScale : scale);
+	if ((float)scale == _scale)
+		return;
+	_scale = (float)scale;
+	_changes++;
+	// measurements from before the change no longer apply
+	_cooldown = COOLDOWN_FRAMES;
+	_smoothedMs = -1.0;
+}
+
+void DynamicResolution::Begin(int windowWidth, int windowHeight, int& width, int& height)
+{
+	TRACE_SCOPE("DynamicResolution::Begin");
+	_windowWidth = windowWidth > 0 ? windowWidth : 1;
+	_windowHeight = windowHeight > 0 ? windowHeight : 1;
+	if (_allocatedWidth != _windowWidth || _allocatedHeight != _windowHeight)
+		Allocate(_windowWidth, _windowHeight);
+
+	Collect();
+	int slot = _frame % QUERY_FRAMES;
+	glQueryCounter(_queries[slot][0], GL_TIMESTAMP);
+	_issuedScale[slot] = _scale;
+
+	_width = (int)(_windowWidth * _scale + 0.5f);
+	_height = (int)(_windowHeight * _scale + 0.5f);
+	_width = _width < 1 ? 1 : _width;
+	_height = _height < 1 ? 1 : _height;
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	glViewport(0, 0, _width, _height);
+	width = _width;
+	height = _height;
+}
+
+void DynamicResolution::End(GLuint output)
+{
+	TRACE_SCOPE("DynamicResolution::End");
+	if (_width == _windowWidth && _height == _windowHeight) {
+		// full size: a copy, no filtering pass needed
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, output);
+		glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, output);
+		return;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, output);
+	glViewport(0, 0, _windowWidth, _windowHeight);
+
+	float texelX = 1.0f / _allocatedWidth;
+	float texelY = 1.0f / _allocatedHeight;
+	glState().UseProgram(_program);
+	glUniform2f(_sourceScaleID, _width * texelX, _height * texelY);
+	glUniform2f(_texelSizeID, texelX, texelY);
+	glUniform2f(_sourceMaxID, (_width - 0.5f) * texelX, (_height - 0.5f) * texelY);
+	// nothing to sharpen at full size, full strength at the smallest scale
+	float strength = _minScale < 1.0f ? (1.0f - _scale) / (1.0f - _minScale) : 0.0f;
+	glState().Uniform1f(_sharpnessID, _sharpness * strength);
+	glState().BindTexture(0, _color);
+	glState().BindVertexArray(_vao);
+	glState().Set(RenderState::DEPTH_TEST, false);
+	glState().Set(RenderState::BLEND, false);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void DynamicResolution::Finish()
+{
+	int slot = _frame % QUERY_FRAMES;
+	glQueryCounter(_queries[slot][1], GL_TIMESTAMP);
+	_pending[slot] = true;
+	_frame++;
+}
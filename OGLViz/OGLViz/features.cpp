@@ -0,0 +1,71 @@
+#include <math.h>
+
+#include "headers\\fft.hpp"
+#include "headers\\features.hpp"
+#include "headers\\trace.hpp"
+
+static const float BEAT_RATIO = 1.4f;        // energy over average that counts as an onset
+static const float AVERAGE_DECAY = 0.98f;    // ~1 s memory at 20 ms buffers
+static const uint64_t REFRACTORY_NS = 120000000ull;
+
+FeatureExtractor::FeatureExtractor(int points, long sampleRate)
+	: _binCount(points / 2 < MAX_BINS ? points / 2 : MAX_BINS),
+	_sampleRate(sampleRate),
+	_sequence(0)
+{
+	// octave-ish bands from 20 Hz up to Nyquist
+	double lo = 20.0;
+	double hi = sampleRate / 2.0;
+	double ratio = pow(hi / lo, 1.0 / NUM_BANDS);
+	double edge = lo;
+	for (int b = 0; b <= NUM_BANDS; b++) {
+		int bin = (int)(edge * points / sampleRate);
+		if (bin < 1)
+			bin = 1;
+		if (bin > _binCount)
+			bin = _binCount;
+		// keep every band at least one bin wide
+		if (b > 0 && bin <= _bandStart[b - 1] && _bandStart[b - 1] < _binCount)
+			bin = _bandStart[b - 1] + 1;
+		_bandStart[b] = bin;
+		edge *= ratio;
+	}
+	_bandStart[NUM_BANDS] = _binCount;
+
+	for (int b = 0; b < NUM_BANDS; b++) {
+		_average[b] = 0.0f;
+		_lastBeatNs[b] = 0;
+	}
+}
+
+void FeatureExtractor::Process(Fft const& fft, uint64_t captureTimeNs, AnalysisFrame& frame)
+{
+	TRACE_SCOPE("FeatureExtractor::Process");
+	frame.captureTimeNs = captureTimeNs;
+	frame.sequence = _sequence++;
+	frame.sampleRate = (uint32_t)_sampleRate;
+	frame.binCount = (uint32_t)_binCount;
+	frame.beatFlags = 0;
+
+	for (int i = 0; i < _binCount; i++)
+		frame.spectrum[i] = (float)fft.GetIntensity(i);
+
+	for (int b = 0; b < NUM_BANDS; b++) {
+		float energy = 0.0f;
+		int start = _bandStart[b];
+		int end = _bandStart[b + 1];
+		for (int i = start; i < end; i++)
+			energy += frame.spectrum[i] * frame.spectrum[i];
+		if (end > start)
+			energy /= (end - start);
+		frame.bands[b] = energy;
+
+		if (energy > BEAT_RATIO * _average[b] && captureTimeNs - _lastBeatNs[b] > REFRACTORY_NS) {
+			frame.beatFlags |= 1u << b;
+			_lastBeatNs[b] = captureTimeNs;
+			if (b < 2)
+				frame.beatFlags |= BEAT_ANY;
+		}
+		_average[b] = AVERAGE_DECAY * _average[b] + (1.0f - AVERAGE_DECAY) * energy;
+	}
+}
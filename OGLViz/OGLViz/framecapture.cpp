@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <GL\\glew.h>
+
+#include "headers\\shader.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\framecapture.hpp"
+
+// a pipe must be binary on Windows, and POSIX popen knows no "b"
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define PIPE_MODE "wb"
+#else
+#define PIPE_MODE "w"
+#endif
+
+static GLuint createTarget(GLenum internalFormat, GLenum format, int width, int height, GLuint& framebuffer)
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glState().BindTexture(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	return texture;
+}
+
+// the path is the format string for the file names, so it may hold one
+// int conversion ("%05d") and nothing else that would read an argument
+static bool isFramePattern(const char* path)
+{
+	int conversions = 0;
+	for (const char* p = strchr(path, '%'); p != NULL; p = strchr(p, '%')) {
+		p++;
+		if (*p == '%') {
+			p++;
+			continue;
+		}
+		while (*p != 0 && strchr("-+ #0", *p) != NULL)
+			p++;
+		while (*p >= '0' && *p <= '9')
+			p++;
+		if (*p == '.')
+			for (p++; *p >= '0' && *p <= '9'; p++)
+				;
+		if (*p == 0 || strchr("diouxX", *p) == NULL)
+			return false;
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+FrameCapture::FrameCapture()
+	: _file(NULL), _pipe(false), _format(Y4M), _width(0), _height(0), _frameBytes(0), _program(0), _sizeID(-1),
+	_vao(0), _source(0), _sourceFramebuffer(0), _planes(0), _planesFramebuffer(0), _next(0), _oldest(0), _pending(0),
+	_closing(false), _written(0), _stalls(0)
+{
+	for (int i = 0; i < RING; i++) {
+		_buffers[i] = 0;
+		_fences[i] = 0;
+		_states[i] = FREE;
+		_mapped[i] = NULL;
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	Close();
+	glDeleteFramebuffers(1, &_sourceFramebuffer);
+	glDeleteFramebuffers(1, &_planesFramebuffer);
+	glDeleteTextures(1, &_source);
+	glDeleteTextures(1, &_planes);
+	glDeleteVertexArrays(1, &_vao);
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+}
+
+bool FrameCapture::InitConversion(const char* vertexShaderPath, const char* yuvShaderPath)
+{
+	_program = LoadShaders(vertexShaderPath, yuvShaderPath);
+	if (_program == 0)
+		return false;
+	// whatever the caller has bound stays bound
+	GLint bound = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound);
+	_sizeID = glGetUniformLocation(_program, "size");
+	glState().UseProgram(_program);
+	glState().Uniform1i(glGetUniformLocation(_program, "source"), 0);
+	_source = createTarget(GL_RGBA8, GL_RGBA, _width, _height, _sourceFramebuffer);
+	_planes = createTarget(GL_R8, GL_RED, _width, _height + _height / 2, _planesFramebuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, bound);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Capture conversion target incomplete (0x%x)\n", status);
+		return false;
+	}
+	// the pass comes from gl_VertexID, the VAO is only there for core profile
+	glGenVertexArrays(1, &_vao);
+	return glGetError() == GL_NO_ERROR;
+}
+
+bool FrameCapture::Open(const char* path, int width, int height, double fps, const char* vertexShaderPath,
+	const char* yuvShaderPath)
+{
+	_pipe = path[0] == '|';
+	size_t length = strlen(path);
+	if (_pipe || (length >= 4 && strcmp(path + length - 4, ".y4m") == 0))
+		_format = Y4M;
+	else
+		_format = strchr(path, '%') != NULL ? PPM_SEQUENCE : RGB24;
+	if (_format == Y4M && (width % 2 != 0 || height % 2 != 0)) {
+		fprintf(stderr, "Y4M capture needs an even size, not %dx%d\n", width, height);
+		return false;
+	}
+	if (_format == PPM_SEQUENCE && !isFramePattern(path)) {
+		fprintf(stderr, "Capture path %s needs exactly one frame number conversion such as %%05d\n", path);
+		return false;
+	}
+	if (_format == PPM_SEQUENCE)
+		_pattern = path;
+	else if (_pipe)
+		_file = popen(path + 1, PIPE_MODE);
+	else if (fopen_s(&_file, path, "wb") != 0)
+		_file = NULL;
+	if (_format != PPM_SEQUENCE && _file == NULL) {
+		fprintf(stderr, "Could not open %s for capture\n", path);
+		return false;
+	}
+	_width = width;
+	_height = height;
+	if (_format == Y4M) {
+		if (!InitConversion(vertexShaderPath, yuvShaderPath)) {
+			fprintf(stderr, "Could not set up the YUV conversion for capture\n");
+			return false;
+		}
+		fprintf(_file, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg\n", width, height, (int)(fps * 1000.0 + 0.5));
+	}
+
+	_frameBytes = (size_t)width * height * (_format == Y4M ? 3 : 8) / 2;
+	glGenBuffers(RING, _buffers);
+	for (int i = 0; i < RING; i++) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, _buffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, _frameBytes, NULL, GL_STREAM_READ);
+		_states[i] = FREE;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_next = _oldest = _pending = 0;
+	_closing = false;
+	_written = 0;
+	_stalls = 0;
+	_writer = std::thread(&FrameCapture::WriterLoop, this);
+	return true;
+}
+
+void FrameCapture::Capture(GLuint framebuffer)
+{
+	if (!IsOpen())
+		return;
+	TRACE_SCOPE("FrameCapture::Capture");
+	// give back whatever the writer has finished with
+	for (int i = 0; i < RING; i++) {
+		bool written;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			written = _states[i] == WRITTEN;
+		}
+		if (written)
+			Unmap(i);
+	}
+	// the ring came round to a buffer the writer still reads from
+	int slot = _next;
+	bool stalled = false;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (_states[slot] == WRITING) {
+			stalled = true;
+			_freed.wait(lock);
+		}
+	}
+	if (stalled) {
+		_stalls++;
+		Unmap(slot);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _buffers[slot]);
+	// into the buffer, so this returns before the copy is done
+	if (_format == Y4M) {
+		Convert(framebuffer);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _planesFramebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, _width, _height + _height / 2, GL_RED, GL_UNSIGNED_BYTE, (void*)0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	}
+	else {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	// back to the caller's target
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_states[slot] = READING;
+	_next = (_next + 1) % RING;
+	_pending++;
+
+	if (_pending > READ_LATENCY)
+		Retire();
+}
+
+// copies the frame into a texture and draws its Y, U and V planes
+void FrameCapture::Convert(GLuint framebuffer)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _sourceFramebuffer);
+	glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _planesFramebuffer);
+	glViewport(0, 0, _width, _height + _height / 2);
+	glState().UseProgram(_program);
+	glUniform2i(_sizeID, _width, _height);
+	glState().BindTexture(0, _source);
+	glState().BindVertexArray(_vao);
+	glState().Set(RenderState::DEPTH_TEST, false);
+	glState().Set(RenderState::BLEND, false);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glViewport(0, 0, _width, _height);
+}
+
+// maps the oldest readback and hands it to the writer
+void FrameCapture::Retire()
+{
+	TRACE_SCOPE("FrameCapture::Retire");
+	int slot = _oldest;
+	// normally signalled already; flush in case the commands never left
+	glClientWaitSync(_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+	glDeleteSync(_fences[slot]);
+	_fences[slot] = 0;
+	_oldest = (_oldest + 1) % RING;
+	_pending--;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _buffers[slot]);
+	const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, _frameBytes, GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (pixels == NULL) {
+		_states[slot] = FREE;
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	_mapped[slot] = (const uint8_t*)pixels;
+	_states[slot] = WRITING;
+	_queued.push_back(slot);
+	_wake.notify_one();
+}
+
+void FrameCapture::Unmap(int slot)
+{
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _buffers[slot]);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_mapped[slot] = NULL;
+	_states[slot] = FREE;
+}
+
+void FrameCapture::WriterLoop()
+{
+	TRACE_THREAD_NAME("capture writer");
+	for (;;) {
+		int slot;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (_queued.empty() && !_closing)
+				_wake.wait(lock);
+			if (_queued.empty())
+				break;
+			slot = _queued.front();
+			_queued.pop_front();
+		}
+
+		// mapped memory is plain memory to this thread; only the unmap needs the context
+		WriteFrame(_mapped[slot]);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_states[slot] = WRITTEN;
+		_freed.notify_one();
+	}
+}
+
+// YUV planes as converted, top-down; RGBA bottom-up as read, files want it top-down
+void FrameCapture::WriteFrame(const uint8_t* pixels)
+{
+	TRACE_SCOPE("FrameCapture::WriteFrame");
+	if (_format == Y4M) {
+		fputs("FRAME\n", _file);
+		fwrite(pixels, 1, (size_t)_width * _height, _file);
+		// the left halves of the chroma rows are U, the right halves V
+		const uint8_t* chroma = pixels + (size_t)_width * _height;
+		for (int half = 0; half < 2; half++)
+			for (int row = 0; row < _height / 2; row++)
+				fwrite(chroma + (size_t)row * _width + half * (_width / 2), 1, _width / 2, _file);
+		_written++;
+		return;
+	}
+
+	size_t stride = (size_t)_width * 4;
+	_converted.resize((size_t)_width * _height * 3);
+	uint8_t* out = &_converted[0];
+	for (int row = 0; row < _height; row++) {
+		const uint8_t* in = pixels + (_height - 1 - row) * stride;
+		for (int x = 0; x < _width; x++, in += 4, out += 3) {
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+		}
+	}
+	FILE* file = _file;
+	if (_format == PPM_SEQUENCE) {
+		char name[1024];
+		snprintf(name, sizeof(name), _pattern.c_str(), (int)_written);
+		if (fopen_s(&file, name, "wb") != 0 || file == NULL) {
+			fprintf(stderr, "Could not open %s for capture\n", name);
+			return;
+		}
+		fprintf(file, "P6\n%d %d\n255\n", _width, _height);
+	}
+	fwrite(&_converted[0], 1, _converted.size(), file);
+	if (_format == PPM_SEQUENCE)
+		fclose(file);
+	_written++;
+}
+
+void FrameCapture::Close()
+{
+	if (!IsOpen())
+		return;
+	while (_pending > 0)
+		Retire();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_closing = true;
+	}
+	_wake.notify_one();
+	_writer.join();
+
+	for (int i = 0; i < RING; i++)
+		if (_mapped[i] != NULL)
+			Unmap(i);
+	glDeleteBuffers(RING, _buffers);
+	for (int i = 0; i < RING; i++)
+		_buffers[i] = 0;
+	if (_file != NULL && _pipe)
+		pclose(_file);
+	else if (_file != NULL)
+		fclose(_file);
+	_file = NULL;
+	_queued.clear();
+}
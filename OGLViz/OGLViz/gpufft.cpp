@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+#include <GL\\glew.h>
+
+#include "headers\\shader.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\gpufft.hpp"
+
+#define PI (2.0 * asin(1.0))
+
+// width x 1 texture addressed with texelFetch only
+static GLuint createLine(GLenum internalFormat, GLenum format, int width, const float* data)
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glState().BindTexture(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, 1, 0, format, GL_FLOAT, data);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+static bool attach(GLuint framebuffer, GLuint texture)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "GPU FFT float target incomplete (0x%x)\n", status);
+		return false;
+	}
+	return true;
+}
+
+GpuFft::GpuFft()
+	: _passProgram(0), _magnitudeProgram(0), _firstPassID(-1), _headID(-1), _pointsID(-1), _radixID(-1),
+	_strideID(-1), _scaleID(-1), _vao(0), _ring(0), _twiddles(0), _spectrum(0), _spectrumFramebuffer(0),
+	_points(0), _head(0), _passCount(0)
+{
+	_work[0] = _work[1] = 0;
+	_workFramebuffers[0] = _workFramebuffers[1] = 0;
+}
+
+GpuFft::~GpuFft()
+{
+	glDeleteFramebuffers(2, _workFramebuffers);
+	glDeleteFramebuffers(1, &_spectrumFramebuffer);
+	glDeleteTextures(2, _work);
+	glDeleteTextures(1, &_spectrum);
+	glDeleteTextures(1, &_ring);
+	glDeleteTextures(1, &_twiddles);
+	glDeleteVertexArrays(1, &_vao);
+	glState().ForgetProgram(_passProgram);
+	glDeleteProgram(_passProgram);
+	glState().ForgetProgram(_magnitudeProgram);
+	glDeleteProgram(_magnitudeProgram);
+}
+
+bool GpuFft::Init(int points, const char* vertexShaderPath, const char* passShaderPath, const char* magnitudeShaderPath)
+{
+	if (points < 2 || points > MAX_POINTS || (points & (points - 1)) != 0) {
+		fprintf(stderr, "GPU FFT needs a power of 2 up to %d points, not %d\n", (int)MAX_POINTS, points);
+		return false;
+	}
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (points > maxSize) {
+		fprintf(stderr, "GPU FFT of %d points is wider than the largest texture (%d)\n", points, maxSize);
+		return false;
+	}
+	_points = points;
+
+	_passProgram = LoadShaders(vertexShaderPath, passShaderPath);
+	_magnitudeProgram = LoadShaders(vertexShaderPath, magnitudeShaderPath);
+	if (_passProgram == 0 || _magnitudeProgram == 0)
+		return false;
+	_firstPassID = glGetUniformLocation(_passProgram, "firstPass");
+	_headID = glGetUniformLocation(_passProgram, "head");
+	_pointsID = glGetUniformLocation(_passProgram, "points");
+	_radixID = glGetUniformLocation(_passProgram, "radix");
+	_strideID = glGetUniformLocation(_passProgram, "stride");
+	_scaleID = glGetUniformLocation(_magnitudeProgram, "scale");
+	glState().UseProgram(_passProgram);
+	glState().Uniform1i(glGetUniformLocation(_passProgram, "source"), 0);
+	glState().Uniform1i(glGetUniformLocation(_passProgram, "twiddles"), 1);
+	glState().Uniform1i(_pointsID, _points);
+	glState().UseProgram(_magnitudeProgram);
+	glState().Uniform1i(glGetUniformLocation(_magnitudeProgram, "source"), 0);
+	glState().Uniform1f(_scaleID, (float)(1.0 / sqrt((double)_points)));
+
+	// radix 4 while it fits, radix 2 for what is left
+	_passCount = 0;
+	for (int span = 1; span < _points; ) {
+		int radix = span * 4 <= _points ? 4 : 2;
+		_radices[_passCount++] = radix;
+		span *= radix;
+	}
+
+	// exp(-2 pi i t / N), worked out in double like Fft's table
+	std::vector<float> table(2 * _points);
+	for (int t = 0; t < _points; t++) {
+		table[2 * t] = (float)cos(2. * PI * t / _points);
+		table[2 * t + 1] = (float)-sin(2. * PI * t / _points);
+	}
+	std::vector<float> silence(_points, 0.0f);
+	_twiddles = createLine(GL_RG32F, GL_RG, _points, &table[0]);
+	_ring = createLine(GL_R32F, GL_RED, _points, &silence[0]);
+	_work[0] = createLine(GL_RG32F, GL_RG, _points, NULL);
+	_work[1] = createLine(GL_RG32F, GL_RG, _points, NULL);
+	_spectrum = createLine(GL_R32F, GL_RED, _points / 2, NULL);
+	glGenFramebuffers(2, _workFramebuffers);
+	glGenFramebuffers(1, &_spectrumFramebuffer);
+	bool complete = attach(_workFramebuffers[0], _work[0]) && attach(_workFramebuffers[1], _work[1]) &&
+		attach(_spectrumFramebuffer, _spectrum);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// the passes come from gl_VertexID, the VAO is only there for core profile
+	glGenVertexArrays(1, &_vao);
+	return complete && glGetError() == GL_NO_ERROR;
+}
+
+void GpuFft::CopyIn(const float* samples, int count)
+{
+	TRACE_SCOPE("GpuFft::CopyIn");
+	// only the newest points samples can matter
+	if (count > _points) {
+		samples += count - _points;
+		count = _points;
+	}
+	// overwrite the oldest ones, in at most two pieces
+	glState().BindTexture(0, _ring);
+	int first = _points - _head < count ? _points - _head : count;
+	glTexSubImage2D(GL_TEXTURE_2D, 0, _head, 0, first, 1, GL_RED, GL_FLOAT, samples);
+	if (count > first)
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, count - first, 1, GL_RED, GL_FLOAT, samples + first);
+	_head = (_head + count) % _points;
+}
+
+void GpuFft::Draw(GLuint framebuffer, int width)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, 1);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void GpuFft::Transform()
+{
+	TRACE_SCOPE("GpuFft::Transform");
+	glState().Set(RenderState::DEPTH_TEST, false);
+	glState().Set(RenderState::BLEND, false);
+	glState().BindVertexArray(_vao);
+	glState().UseProgram(_passProgram);
+	glState().Uniform1i(_headID, _head);
+	glState().BindTexture(1, _twiddles);
+
+	int stride = 1;
+	int target = 0;
+	for (int p = 0; p < _passCount; p++) {
+		glState().Uniform1i(_firstPassID, p == 0);
+		glState().Uniform1i(_radixID, _radices[p]);
+		glState().Uniform1i(_strideID, stride);
+		glState().BindTexture(0, p == 0 ? _ring : _work[target ^ 1]);
+		Draw(_workFramebuffers[target], _points);
+		stride *= _radices[p];
+		target ^= 1;
+	}
+
+	glState().UseProgram(_magnitudeProgram);
+	glState().BindTexture(0, _work[target ^ 1]);
+	Draw(_spectrumFramebuffer, _points / 2);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GpuFft::ReadBack(std::vector<float>& intensity)
+{
+	intensity.resize(_points / 2);
+	glBindFramebuffer(GL_FRAMEBUFFER, _spectrumFramebuffer);
+	glReadPixels(0, 0, _points / 2, 1, GL_RED, GL_FLOAT, &intensity[0]);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#ifndef ANALYSIS_HPP
+#define ANALYSIS_HPP
+
+// Capture from the default input, run the Fft and feature extraction and
+// publish every frame until Ctrl+C, on the named spectrum bus and/or the
+// multicast group ("address:port"). Either may be NULL.
+// Returns the process exit code.
+int runAnalysisPublisher(const char* busName, const char* multicastGroup);
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef ANALYSISFRAME_HPP
+#define ANALYSISFRAME_HPP
+
+#include <stdint.h>
+
+// One analysis result, produced per captured buffer.
+// Plain data only: it is copied into shared memory and onto the wire as is.
+enum { MAX_BINS = 4096, NUM_BANDS = 8, SCOPE_POINTS = 512 };
+
+// bit i of beatFlags is set on an onset in band i,
+// BEAT_ANY is set whenever the kick band (band 0 or 1) fires
+enum { BEAT_ANY = 1u << 31 };
+
+struct AnalysisFrame
+{
+	uint64_t captureTimeNs;     // steady clock, when the buffer completed
+	uint32_t sequence;          // frame counter of the publisher
+	uint32_t sampleRate;
+	uint32_t binCount;          // valid entries in spectrum
+	uint32_t beatFlags;
+	float    bands[NUM_BANDS];  // band energies, log spaced from 20 Hz
+	float    correlation;       // L/R correlation, -1 (out of phase) .. +1 (mono)
+	float    balance;           // -1 full left .. +1 full right
+	float    midEnergy;         // mean square of (L+R)/2
+	float    sideEnergy;        // mean square of (L-R)/2
+	float    rmsDb;             // dBFS over the momentary window
+	float    peakDb;            // sample peak of the last buffer, dBFS
+	float    truePeakDb;        // 4x oversampled peak of the last buffer, dBTP
+	float    momentaryLufs;     // 400 ms
+	float    shortTermLufs;     // 3 s
+	float    integratedLufs;    // gated, since start or ResetIntegrated
+	uint32_t scopeCount;        // valid points in scopePoints
+	float    scopePoints[2 * SCOPE_POINTS]; // newest vectorscope (side, mid) pairs, oldest first
+	float    spectrum[MAX_BINS];// magnitude per bin, DC at 0
+};
+
+#endif
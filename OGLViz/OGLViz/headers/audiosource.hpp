@@ -0,0 +1,39 @@
+#pragma once
+#ifndef AUDIOSOURCE_HPP
+#define AUDIOSOURCE_HPP
+
+#include <stdint.h>
+#include <vector>
+
+// Audio for runs without a capture device: a 16-bit PCM WAV file (mono or
+// stereo, looped) or, without a file, a synthetic track with a kick every
+// half second, a sweeping bass, noise hats and a stereo pad. Samples are
+// addressed by absolute position and depend on nothing else, so two runs
+// over the same positions see identical audio.
+class AudioSource
+{
+public:
+	enum { SYNTHETIC_RATE = 44100 };
+
+	AudioSource();
+
+	// NULL selects the synthetic track
+	bool Open(const char* wavPath);
+	// count frames starting at first, de-interleaved, floats in [-1, 1)
+	void Read(uint64_t first, int count, float* left, float* right) const;
+
+	long SampleRate() const { return _sampleRate; }
+	// frames in the file before it loops, 0 for the synthetic track
+	uint64_t Length() const { return _left.size(); }
+	bool Synthetic() const { return _left.empty(); }
+
+private:
+	bool LoadWav(const char* path);
+	void Synthesize(uint64_t position, float& left, float& right) const;
+
+	long               _sampleRate;
+	std::vector<float> _left;
+	std::vector<float> _right;
+};
+
+#endif
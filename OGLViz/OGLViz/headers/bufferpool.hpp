@@ -0,0 +1,42 @@
+#pragma once
+#ifndef BUFFERPOOL_HPP
+#define BUFFERPOOL_HPP
+
+class Recorder;
+
+// Sizes the Recorder's buffer pool at runtime.
+// Call Update once per captured buffer, right after Recorder::BufferDone.
+// - the pool grows as soon as the consumer lag gets close to the pool size
+// - every WINDOW buffers the per-buffer sample count is retuned so that
+//   (peak lag + 1) buffers fit into the latency budget, and an oversized
+//   pool is halved when the peak lag left most of it unused
+// Growing the pool and shrinking the buffers happen at once. Shrinking the
+// pool and growing the buffers only happen after SETTLE_WINDOWS windows in
+// a row that needed neither, so a lag hovering around a threshold can't
+// resize the recorder back and forth.
+class BufferPoolController
+{
+public:
+    enum { WINDOW = 64, SETTLE_WINDOWS = 4 };
+
+    // maxSamples should not exceed the Fft point count (CopyIn drops bigger buffers)
+    BufferPoolController(double latencyBudgetMs, int minSamples = 256, int maxSamples = 4096);
+
+    void    SetLatencyBudget(double latencyBudgetMs) { _budgetMs = latencyBudgetMs; }
+    double  LatencyBudget() const { return _budgetMs; }
+
+    // returns true when the recorder was resized
+    bool    Update(Recorder& recorder);
+
+private:
+    int     TargetSamples(Recorder const& recorder) const;
+
+    double  _budgetMs;
+    int     _minSamples;
+    int     _maxSamples;
+    int     _peakLag;       // worst lag seen in the current window
+    int     _cObserved;     // buffers seen in the current window
+    int     _cCalm;         // windows in a row without a grow or smaller buffers
+};
+
+#endif
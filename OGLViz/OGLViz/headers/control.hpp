@@ -2,6 +2,31 @@
 #ifndef CONTROLS_HPP
 #define CONTROLS_HPP
 
+// Keyboard and mouse since the last read. Mouse movement is in pixels and
+// applies once; the keys move the camera for as long as they are held.
+struct ControlInput
+{
+	float mouseX;
+	float mouseY;
+	bool  forward, backward, right, left;
+};
+
+struct CameraState
+{
+	glm::vec3 position;
+	float     horizontalAngle;
+	float     verticalAngle;
+	float     fov;              // degrees
+};
+
+// main thread only, GLFW input is not thread safe
+ControlInput readControlInput();
+CameraState initialCamera();
+void stepCamera(CameraState& camera, ControlInput const& input, float deltaTime);
+CameraState lerpCamera(CameraState const& a, CameraState const& b, float t);
+glm::mat4 cameraProjection(CameraState const& camera, float aspect);
+glm::mat4 cameraView(CameraState const& camera);
+
 void computeMatricesFromInputs();
 glm::mat4 getViewMatrix();
 glm::mat4 getProjectionMatrix();
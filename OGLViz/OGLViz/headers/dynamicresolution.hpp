@@ -0,0 +1,84 @@
+#pragma once
+#ifndef DYNAMICRESOLUTION_HPP
+#define DYNAMICRESOLUTION_HPP
+
+// Renders the scene into an offscreen target whose size follows the GPU
+// frame time, then upscales it to the window (bilinear plus an optional
+// clamped sharpen).
+//
+// GPU time is measured with a pair of GL_TIMESTAMP queries per frame, from
+// Begin to Finish, so whatever runs after the upscale (post processing)
+// counts against the budget too (timestamps do not conflict with the
+// profiler's time elapsed queries). Results are read back QUERY_FRAMES
+// later once available, and smoothed; a result from a frame drawn at an
+// older scale is dropped. Since the
+// cost of fill-bound work goes with the pixel count, a new scale is
+// sqrt(target / measured) times the old one, aiming at TARGET_FRACTION of
+// the budget. Hysteresis: nothing changes while the smoothed time stays
+// between LOW_FRACTION and HIGH_FRACTION of the budget, and after each
+// change the controller waits COOLDOWN_FRAMES for the new size to show up
+// in the measurements.
+//
+// The target is allocated at the full window size and the scene only
+// draws into the bottom left part of it, so scale changes cost nothing.
+//
+//     int w, h;
+//     resolution.Begin(windowWidth, windowHeight, w, h);
+//     scene.Render(..., w, h);
+//     resolution.End();            // upscale to the window
+//     post.End();                  // anything else the frame costs
+//     resolution.Finish();
+class DynamicResolution
+{
+public:
+	enum { QUERY_FRAMES = 4, COOLDOWN_FRAMES = 20, SCALE_STEPS = 64 };
+
+	DynamicResolution();
+	~DynamicResolution();
+
+	// budgetMs: GPU frame time to hold, e.g. 16.6 for 60 Hz
+	bool Init(double budgetMs, float minScale, float maxScale, float sharpness,
+		const char* vertexShaderPath, const char* fragmentShaderPath);
+	void SetProgram(GLuint program);
+
+	// binds the target and sets the viewport to the scaled size
+	void Begin(int windowWidth, int windowHeight, int& width, int& height);
+	// upscale into output, 0 for the window
+	void End(GLuint output = 0);
+	// the frame's GPU work is all submitted, stop timing it
+	void Finish();
+
+	float  Scale() const { return _scale; }
+	double GpuMs() const { return _smoothedMs; }
+	unsigned Changes() const { return _changes; }
+
+private:
+	bool Allocate(int width, int height);
+	void Collect();
+	void Control();
+
+	GLuint _program;
+	GLint  _sourceScaleID, _texelSizeID, _sourceMaxID, _sharpnessID;
+	GLuint _vao;
+	GLuint _framebuffer;
+	GLuint _color;
+	GLuint _depth;
+	int    _allocatedWidth, _allocatedHeight;
+	int    _windowWidth, _windowHeight;
+	int    _width, _height;           // scaled size of the current frame
+
+	double _budgetMs;
+	float  _minScale, _maxScale;
+	float  _sharpness;
+	float  _scale;
+	double _smoothedMs;               // < 0 until the first result
+	int    _cooldown;
+	unsigned _changes;
+
+	GLuint _queries[QUERY_FRAMES][2];
+	bool   _pending[QUERY_FRAMES];
+	float  _issuedScale[QUERY_FRAMES]; // scale the slot's frame was drawn at
+	int    _frame;
+};
+
+#endif
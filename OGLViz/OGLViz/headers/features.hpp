@@ -0,0 +1,29 @@
+#pragma once
+#ifndef FEATURES_HPP
+#define FEATURES_HPP
+
+#include "analysisframe.hpp"
+
+class Fft;
+
+// Turns a transformed Fft into an AnalysisFrame:
+// spectrum magnitudes, log spaced band energies and per band onsets.
+// An onset fires when a band's energy exceeds its running average by
+// BEAT_RATIO, at most once per refractory period.
+class FeatureExtractor
+{
+public:
+	FeatureExtractor(int points, long sampleRate);
+
+	void Process(Fft const& fft, uint64_t captureTimeNs, AnalysisFrame& frame);
+
+private:
+	int      _binCount;
+	long     _sampleRate;
+	uint32_t _sequence;
+	int      _bandStart[NUM_BANDS + 1];  // first bin of each band, plus end
+	float    _average[NUM_BANDS];        // running band energy
+	uint64_t _lastBeatNs[NUM_BANDS];
+};
+
+#endif
@@ -303,32 +303,50 @@ inline void WaveInDevice::UnPrepare(WaveHeader* pHeader)
 class Recorder
 {
     friend class SampleIter;
-    enum { NUM_BUF = 8 };
 public:
+    enum { DEF_NUM_BUF = 8, MIN_NUM_BUF = 2, MAX_NUM_BUF = 64 };
+
     Recorder(
         int cSamples,
         int cSamplePerSec,
         int nChannels,
-        int bitsPerSecond);
+        int bitsPerSecond,
+        int numBuf = DEF_NUM_BUF);
 
     ~Recorder();
     BOOL    Start(Event& event);
-    void    Stop() { delete[]_pBuf; };
+    void    Stop();
     BOOL    BufferDone();
+    // Re-size the buffer pool and/or the per-buffer sample count
+    // while keeping the device open. Pending data is dropped.
+    BOOL    Resize(int numBuf, int cSamples);
 
     BOOL    IsBufferDone() const
     {
         return _header[_iBuf].IsDone();
     }
 
+    // number of filled buffers waiting for the consumer
+    int     PendingBuffers() const;
+
+    // Split the current 16-bit buffer into per channel floats in [-1, 1).
+    // Mono input is copied to both. Whole buffer at once, no virtual calls.
+    void    CopyChannels(float* left, float* right) const;
+
     BOOL    IsStarted() const { return _isStarted; }
     int     SampleCount() const { return _cSamples; }
+    int     BufferCount() const { return _numBuf; }
     int     BitsPerSample() const { return _bitsPerSample; }
     int     SamplesPerSecond() const { return _cSamplePerSec; }
+    int     Channels() const { return _nChannels; }
 protected:
     virtual int GetSample(char* pBuf, int i) const = 0;
     char* GetData() const { return _header[_iBuf].lpData; }
 
+    void    Allocate();
+    void    Release();
+    void    Queue(int i);
+
     BOOL            _isStarted;
 
     WaveInDevice    _waveInDevice;
@@ -339,33 +357,80 @@ protected:
     int             _cbSampleSize;      // bytes per sample
 
     int             _cbBuf;             // bytes per buffer
+    int             _numBuf;            // buffers in the pool
     int             _iBuf;              // current buffer #
     char* _pBuf;              // pool of buffers
-    WaveHeader      _header[NUM_BUF]{};  // pool of headers 
+    WaveHeader* _header;            // pool of headers 
 };
 
-Recorder::Recorder(
+inline Recorder::Recorder(
     int cSamples,
     int cSamplePerSec,
     int nChannels,
-    int bitsPerSample)
+    int bitsPerSample,
+    int numBuf)
     : _iBuf(0),
     _cSamplePerSec(cSamplePerSec),
     _cSamples(cSamples),
     _cbSampleSize(nChannels* bitsPerSample / 8),
     _cbBuf(cSamples* nChannels* bitsPerSample / 8),
+    _numBuf(numBuf),
     _nChannels(nChannels),
     _bitsPerSample(bitsPerSample),
-    _isStarted(FALSE)
+    _isStarted(FALSE),
+    _pBuf(0),
+    _header(0)
 {
-    _pBuf = new char[(int)(_cbBuf * NUM_BUF)];
+    Allocate();
 }
 
-Recorder::~Recorder()
+inline Recorder::~Recorder()
 {
     Stop();
 }
 
+inline void Recorder::Allocate()
+{
+    _pBuf = new char[(int)(_cbBuf * _numBuf)];
+    _header = new WaveHeader[_numBuf]{};
+}
+
+inline void Recorder::Release()
+{
+    delete[]_pBuf;
+    delete[]_header;
+    _pBuf = 0;
+    _header = 0;
+}
+
+class RecorderM16 : public Recorder
+{
+public:
+    RecorderM16(int cSamples, int cSamplePerSec)
+        : Recorder(cSamples, cSamplePerSec, 1, 16)
+    {}
+protected:
+    int GetSample(char* pBuf, int i) const
+    {
+        return ((short*)pBuf)[i];
+    }
+};
+
+// stereo capture, the iterator sees the mid (L+R)/2 signal
+class RecorderS16 : public Recorder
+{
+public:
+    RecorderS16(int cSamples, int cSamplePerSec)
+        : Recorder(cSamples, cSamplePerSec, 2, 16)
+    {}
+protected:
+    int GetSample(char* pBuf, int i) const
+    {
+        short* p = (short*)pBuf;
+        return (p[2 * i] + p[2 * i + 1]) / 2;
+    }
+};
+
 class SampleIter
 {
 public:
@@ -393,6 +458,8 @@ public:
     int     Points() const { return _Points; }
     void    Transform();
     void    CopyIn(SampleIter& iter);
+    // samples from any other source, in the recorder's 16-bit scale
+    void    CopyIn(const float* samples, int cSample);
 
     double  GetIntensity(int i) const
     {
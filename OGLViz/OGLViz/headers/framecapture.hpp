@@ -0,0 +1,101 @@
+#pragma once
+#ifndef FRAMECAPTURE_HPP
+#define FRAMECAPTURE_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Records the rendered frames to a file or a pipe without stalling the
+// render thread on glReadPixels.
+//
+// Capture starts an asynchronous readback of the framebuffer into the
+// next of RING pixel pack buffers and puts a fence behind it. A buffer is
+// mapped READ_LATENCY frames later, by which time its fence has normally
+// signalled and the copy overlapped the frames in between, and the mapped
+// pointer itself goes to a writer thread, which converts and writes
+// straight out of it: the pixels are never copied on the render thread.
+// The buffer is unmapped on the render thread once the writer is done
+// with it. The render thread only waits when the ring comes round to a
+// buffer the writer still holds (counted in Stalls).
+//
+// Output is YUV4MPEG2 (4:2:0, full range BT.601) for a .y4m path or a
+// pipe, one binary PPM per frame for a path with a printf frame number in
+// it ("frames/%05d.ppm", exactly one int conversion, %% for a literal
+// percent sign), raw top-down RGB24 for anything else. A path
+// starting with '|' is a command that gets the stream on its standard
+// input, e.g. "|ffmpeg -y -i - show.mp4". YUV frames are converted by a
+// fragment shader into an R8 target before the readback, so they cross
+// the bus at 1.5 bytes a pixel instead of 4 and the writer only writes.
+class FrameCapture
+{
+public:
+	enum { RING = 6, READ_LATENCY = 2 };
+	enum Format { Y4M, RGB24, PPM_SEQUENCE };
+
+	FrameCapture();
+	~FrameCapture();
+
+	// Y4M needs an even width and height
+	bool Open(const char* path, int width, int height, double fps, const char* vertexShaderPath,
+		const char* yuvShaderPath);
+	// reads back the framebuffer's bottom left width x height, once per frame
+	void Capture(GLuint framebuffer);
+	// drains the ring and the writer, then closes the output
+	void Close();
+
+	bool     IsOpen() const { return _writer.joinable(); }
+	int      Width() const { return _width; }
+	int      Height() const { return _height; }
+	uint64_t Frames() const { return _written; }
+	unsigned Stalls() const { return _stalls; }
+
+private:
+	enum SlotState { FREE, READING, WRITING, WRITTEN };
+
+	bool InitConversion(const char* vertexShaderPath, const char* yuvShaderPath);
+	void Convert(GLuint framebuffer);
+	void Retire();
+	void Unmap(int slot);
+	void WriterLoop();
+	void WriteFrame(const uint8_t* pixels);
+
+	FILE*   _file;             // NULL for an image sequence
+	std::string _pattern;      // image sequence file names
+	bool    _pipe;
+	Format  _format;
+	int     _width, _height;
+	size_t  _frameBytes;       // read back per frame
+	// YUV conversion: the frame copied into a texture, then converted into planes
+	GLuint  _program;
+	GLint   _sizeID;
+	GLuint  _vao;
+	GLuint  _source, _sourceFramebuffer;
+	GLuint  _planes, _planesFramebuffer;
+	GLuint  _buffers[RING];
+	GLsync  _fences[RING];
+	// slots go FREE -> READING (fenced) -> WRITING (mapped, queued) -> WRITTEN -> FREE (unmapped),
+	// each holding the YUV planes, or RGBA bottom-up as read
+	SlotState _states[RING];
+	const uint8_t* _mapped[RING];
+	int     _next;             // slot the next capture reads into
+	int     _oldest;           // slot of the oldest readback in flight
+	int     _pending;          // readbacks in flight
+
+	std::deque<int> _queued;
+	std::vector<uint8_t> _converted;   // writer thread only
+	std::thread _writer;
+	std::mutex  _mutex;
+	std::condition_variable _wake;     // slot queued, or closing
+	std::condition_variable _freed;    // slot written
+	bool     _closing;
+	uint64_t _written;
+	unsigned _stalls;
+};
+
+#endif
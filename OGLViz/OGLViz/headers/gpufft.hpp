@@ -0,0 +1,63 @@
+#pragma once
+#ifndef GPUFFT_HPP
+#define GPUFFT_HPP
+
+#include <vector>
+
+// The same transform as Fft, done by fragment shaders, for render nodes
+// that get raw PCM instead of spectra. Only the headless and export paths
+// have PCM on the render thread; the window renders spectra from the bus
+// or multicast, which carry no samples.
+//
+// New samples go into a points wide R32F ring texture, so only the hop
+// is uploaded each frame. Transform runs Stockham passes between two
+// RG32F textures, radix 4 while it divides what is left and a final
+// radix 2 for odd powers of two, every twiddle coming from an RG32F table
+// texture. A last pass writes |X[k]| / sqrt(points) for the lower half
+// into an R32F texture, the scale of Fft::GetIntensity, which shaders
+// sample directly: nothing is read back on the render path. ReadBack is
+// there for validation.
+//
+// Points must be a power of 2, no wider than the largest texture.
+class GpuFft
+{
+public:
+	enum { MAX_POINTS = 16384, MAX_PASSES = 14 };
+
+	GpuFft();
+	~GpuFft();
+
+	bool Init(int points, const char* vertexShaderPath, const char* passShaderPath, const char* magnitudeShaderPath);
+	// appends samples to the ring, in the recorder's 16-bit scale like Fft::CopyIn
+	void CopyIn(const float* samples, int count);
+	// all passes; leaves the framebuffer binding at 0
+	void Transform();
+
+	int    Points() const { return _points; }
+	int    Passes() const { return _passCount; }
+	// points / 2 bins, R32F, valid after Transform
+	GLuint Spectrum() const { return _spectrum; }
+	// blocking, for validation only
+	void   ReadBack(std::vector<float>& intensity);
+
+private:
+	void Draw(GLuint framebuffer, int width);
+
+	GLuint _passProgram;
+	GLuint _magnitudeProgram;
+	GLint  _firstPassID, _headID, _pointsID, _radixID, _strideID;
+	GLint  _scaleID;
+	GLuint _vao;
+	GLuint _ring;
+	GLuint _twiddles;
+	GLuint _work[2];
+	GLuint _workFramebuffers[2];
+	GLuint _spectrum;
+	GLuint _spectrumFramebuffer;
+	int    _points;
+	int    _head;                  // oldest sample in the ring
+	int    _radices[MAX_PASSES];
+	int    _passCount;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include <stddef.h>
+
+struct HeadlessOptions
+{
+	int         width;
+	int         height;
+	int         frames;       // 0 for the whole audio file
+	double      fps;          // audio advances 1/fps seconds per frame
+	const char* audioPath;    // 16-bit PCM WAV, NULL for the synthetic track
+	int         barCount;
+	int         historyRows;
+	const char* profilePrefix;  // per scope CSV export, NULL for none
+	double      tickRate;       // simulation ticks per second of rendered time
+	double      budgetMs;       // dynamic resolution frame budget, 0 for fixed size
+	float       bloomStrength;  // post process, both 0 to draw the scene straight
+	float       trailPersistence;
+	int         particleCount;  // 0 for none
+	bool        gpuFft;         // bars from GpuFft, checked against Fft
+	const char* recordPath;     // FrameCapture output, NULL for none
+	int         supersample;    // render size over output size: 1, 2 or 4
+	bool        offline;        // export: analysis on a worker thread ahead of the frames, no glFinish per frame
+	double      waveformMs;     // oscilloscope window, 0 for none
+	bool        scopeTrigger;   // hold the oscilloscope on rising zero crossings
+
+	// a 720p benchmark of the synthetic track at Simulation::DEFAULT_RATE
+	// ticks with everything optional off; set the fields by name
+	HeadlessOptions()
+		: width(1280), height(720), frames(600), fps(60.0), audioPath(NULL), barCount(0), historyRows(0),
+		profilePrefix(NULL), tickRate(240.0), budgetMs(0.0), bloomStrength(0.0f), trailPersistence(0.0f),
+		particleCount(0), gpuFft(false), recordPath(NULL), supersample(1), offline(false), waveformMs(0.0),
+		scopeTrigger(false)
+	{
+	}
+};
+
+// Renders the scene into an offscreen framebuffer without a window, for
+// benchmarking on render-farm and CI hosts.
+//
+// The context backend is chosen at build time with the HeadlessBackend
+// project property (msbuild /p:HeadlessBackend=EGL):
+//   GLFW   - the default: a hidden GLFW window. No window shows, but it
+//            still needs a desktop session or X display.
+//   EGL    - defines OGLVIZ_EGL, surfaceless EGL, no display at all.
+//            Links libEGL.lib.
+//   OSMesa - defines OGLVIZ_OSMESA, Mesa's software renderer, no display.
+//            Links osmesa.lib.
+// The stock glew32.lib looks functions up through WGL and fails without a
+// window, so EGL and OSMesa need GLEW built from source with GLEW_EGL or
+// GLEW_OSMESA defined (the property defines it for the headers too) and
+// that glew32.lib in ..\Lib in place of the stock one.
+//
+// Audio is analysed offline frame by frame and the simulation is stepped
+// in rendered time, not wall time, while the camera orbits at a fixed
+// rate, so every run draws the same frames. Prints frame time
+// statistics. Returns the process exit code.
+//
+// With offline set this is the export path: the frame counter is the only
+// clock, nothing waits on a swap or on glFinish, and analysis, rendering
+// and encoding (FrameCapture's readback ring and writer thread) each run
+// on their own thread a few frames apart. The frames are the same ones a
+// benchmark run draws.
+int runHeadless(HeadlessOptions const& options);
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef LOUDNESS_HPP
+#define LOUDNESS_HPP
+
+#include <vector>
+
+#include "analysisframe.hpp"
+
+// Loudness metering on the raw stereo capture (floats in [-1, 1)):
+// RMS and sample peak in dBFS, 4x oversampled true peak in dBTP and
+// EBU R128 / BS.1770 momentary (400 ms), short-term (3 s) and gated
+// integrated loudness in LUFS.
+//
+// K-weighting runs both biquad stages for both channels in one SSE
+// register, stage 2 trailing stage 1 by a sample, so a whole block is one
+// 4-lane recursion. Energy is collected in 100 ms sub-blocks; 400 ms gating
+// blocks with 75% overlap are four consecutive sub-blocks.
+class LoudnessMeter
+{
+public:
+	enum { SUB_BLOCKS = 30, TAPS = 12, PHASES = 4, HISTOGRAM = 750 };
+
+	LoudnessMeter(int sampleRate);
+
+	void Process(const float* left, const float* right, int count, AnalysisFrame& frame);
+	// forget the integrated history, e.g. at the start of a song
+	void ResetIntegrated();
+
+private:
+	void Filter(const float* left, const float* right, int count);
+	float TruePeak(const float* x, float* history, int count);
+	void EndSubBlock();
+	float Integrated() const;
+
+	int   _subBlockSamples;
+	int   _subBlockFill;
+	// lanes: stage 1 L, stage 1 R, stage 2 L, stage 2 R
+	float _b0[4], _b1[4], _b2[4], _a1[4], _a2[4];
+	float _z1[4], _z2[4];
+	float _y[4];                    // previous output, feeds stage 2
+	double _weighted;               // K-weighted energy of the open sub-block, L+R
+	double _raw;                    // unweighted energy of the open sub-block, L+R
+
+	float _subEnergy[SUB_BLOCKS];   // K-weighted mean square per sub-block
+	float _subRaw[SUB_BLOCKS];
+	int   _cSub;                    // sub-blocks completed
+
+	// 400 ms block energies binned by 0.1 LU from -70 LUFS, for gating
+	unsigned _histCount[HISTOGRAM];
+	double   _histEnergy[HISTOGRAM];
+
+	float _taps[PHASES][TAPS];      // polyphase interpolator, reversed
+	float _historyL[TAPS - 1];
+	float _historyR[TAPS - 1];
+	std::vector<float> _scratch;   // history + block for the interpolator
+};
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef MESH_HPP
+#define MESH_HPP
+
+// A loaded model ready to draw.
+// Buffers are uploaded and the attribute layout is recorded in a VAO once,
+// at load, matching the locations in vtxShader.txt:
+//   0 position, 1 UV, 2 normal.
+// Vertices are deduplicated with indexVBO and drawn through an element
+// buffer; the index type is GL_UNSIGNED_SHORT unless the mesh has more
+// than 65536 unique vertices. Drawing is one bind and one glDrawElements.
+class Mesh
+{
+public:
+	enum { ATTRIB_POSITION = 0, ATTRIB_UV = 1, ATTRIB_NORMAL = 2 };
+
+	Mesh();
+	~Mesh();
+
+	bool LoadOBJ(const char* path);
+	void Draw() const;
+
+	GLsizei VertexCount() const { return _vertexCount; }
+	GLsizei IndexCount() const { return _indexCount; }
+	GLenum  IndexType() const { return _indexType; }
+
+private:
+	GLuint  _vao;
+	GLuint  _vertexBuffer;
+	GLuint  _uvBuffer;
+	GLuint  _normalBuffer;
+	GLuint  _indexBuffer;
+	GLsizei _vertexCount;       // unique vertices after indexing
+	GLsizei _indexCount;
+	GLenum  _indexType;
+};
+
+#endif
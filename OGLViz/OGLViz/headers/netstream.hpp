@@ -0,0 +1,82 @@
+#pragma once
+#ifndef NETSTREAM_HPP
+#define NETSTREAM_HPP
+
+#include <stdint.h>
+
+#include "analysisframe.hpp"
+
+// AnalysisFrames over UDP multicast, for render walls with several nodes.
+//
+// A frame is sent once on the wire as 1..MAX_FRAGMENTS datagrams. Every
+// datagram carries the frame header (sequence, capture time, bands, beats,
+// stereo and loudness levels) and a slice of the spectrum quantised to 8 bit dB, so a lost datagram
+// only costs its bins.
+//
+// Receivers hold frames in a small jitter buffer and release each one at
+// capture time + clock offset + playout delay. The offset is the smallest
+// transit seen so far, which every node estimates the same way, so nodes
+// present the same frame within the network jitter of each other.
+// Missing bins or frames are concealed from the previous frame.
+
+enum { NET_MAX_DATAGRAM = 1472, MAX_FRAGMENTS = 8, JITTER_SLOTS = 8 };
+
+class SpectrumSender
+{
+public:
+	SpectrumSender();
+	~SpectrumSender();
+	// group is "address:port", e.g. "239.255.42.1:4242"
+	bool Open(const char* group, int ttl = 1);
+	bool Send(AnalysisFrame const& frame);
+	void Close();
+private:
+	intptr_t _socket;
+	uint8_t  _addr[32];     // sockaddr_in of the group
+	int      _addrLen;
+};
+
+class SpectrumReceiver
+{
+public:
+	SpectrumReceiver();
+	~SpectrumReceiver();
+	bool Open(const char* group, int delayMs);
+	void Close();
+
+	// drain the socket into the jitter buffer, never blocks
+	void Poll(uint64_t nowNs);
+	// next frame due at nowNs, concealed if incomplete or lost
+	bool Next(uint64_t nowNs, AnalysisFrame& out);
+
+	uint64_t Received() const { return _received; }
+	uint64_t Concealed() const { return _concealed; }
+	uint64_t Late() const { return _late; }
+private:
+	struct Pending
+	{
+		bool          used;
+		uint32_t      fragCount;
+		uint32_t      fragMask;       // fragments received
+		AnalysisFrame frame;
+	};
+
+	void     Receive(uint8_t const* data, int len, uint64_t nowNs);
+	void     Conceal(Pending& p);
+	uint64_t DueNs(uint64_t captureTimeNs) const { return captureTimeNs + _offsetNs + _delayNs; }
+
+	intptr_t      _socket;
+	uint64_t      _delayNs;
+	int64_t       _offsetNs;      // local clock - sender clock, min transit
+	bool          _haveOffset;
+	bool          _started;
+	uint32_t      _nextSeq;       // next sequence to hand out
+	uint64_t      _received;
+	uint64_t      _concealed;
+	uint64_t      _late;
+	Pending       _slots[JITTER_SLOTS];
+	AnalysisFrame _last;          // last frame handed out, concealment source
+	bool          _haveLast;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef OFFLINEANALYSIS_HPP
+#define OFFLINEANALYSIS_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "analysisframe.hpp"
+#include "fft.hpp"
+#include "features.hpp"
+#include "stereo.hpp"
+#include "loudness.hpp"
+
+class AudioSource;
+
+// The capture thread's Fft, features, stereo and loudness pipeline, fed
+// from an AudioSource at a fixed frame rate: frame i covers the samples up
+// to (i + 1) / fps seconds and is stamped with that stream position, so
+// the result depends only on the audio and the rate, never on the clock.
+//
+// Started with ahead > 0, a worker thread analyses up to ahead frames in
+// front of the renderer into a ring of slots, so the analysis of the next
+// frames overlaps the drawing of this one. Without Start, Acquire analyses
+// on the calling thread. Frames are acquired in order, and each released
+// before the next is acquired.
+class OfflineAnalysis
+{
+public:
+	enum { MAX_AHEAD = 32 };
+
+	struct Slot
+	{
+		AnalysisFrame      frame;
+		std::vector<float> mid;  // the frame's newest samples, at most points, 16-bit scale like Fft::CopyIn
+		double             ms;   // time the analysis took, on whichever thread
+	};
+
+	OfflineAnalysis(AudioSource const& audio, int points, double fps);
+	~OfflineAnalysis();
+
+	void Start(int ahead);
+	void Stop();
+
+	// frame index, waiting for the worker if it is not there yet
+	Slot const& Acquire(int index);
+	void        Release();
+
+	// acquires that had to wait: the renderer outran the analysis
+	unsigned Waits() const { return _waits; }
+
+private:
+	void WorkerLoop();
+	void Analyse(int index, Slot& slot);
+
+	AudioSource const& _audio;
+	long     _sampleRate;
+	int      _points;
+	double   _fps;
+	uint64_t _position;          // next sample to analyse
+
+	Fft              _fft;
+	FeatureExtractor _features;
+	StereoAnalyzer   _stereo;
+	LoudnessMeter    _loudness;
+	std::vector<float> _left, _right, _mid;
+
+	std::vector<Slot> _slots;
+	int          _ahead;         // 0 without a worker
+	int          _produced;      // frames analysed
+	int          _consumed;      // frames released
+	std::thread  _worker;
+	std::mutex   _mutex;
+	std::condition_variable _ready;   // frame analysed, or stopping
+	std::condition_variable _space;   // slot released, or stopping
+	bool         _stopping;
+	unsigned     _waits;
+};
+
+#endif
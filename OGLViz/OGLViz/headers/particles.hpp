@@ -0,0 +1,60 @@
+#pragma once
+#ifndef PARTICLES_HPP
+#define PARTICLES_HPP
+
+#include "analysisframe.hpp"
+
+// Audio driven particle cloud that lives entirely on the GPU.
+// Each particle is a position and a velocity (two vec4, 32 bytes) in one
+// of two buffers. Update runs a vertex shader over every particle with
+// the rasterizer off and captures its outputs into the other buffer with
+// transform feedback (GL 3.3 core, so it runs on llvmpipe too), then Draw
+// uses that buffer as per instance data for camera facing sprites, one
+// instanced draw for the lot. The CPU only picks how many particles to
+// respawn, so the count is bounded by the GPU alone.
+//
+// Spawning walks a ring: each frame the next spawnCount particles, the
+// oldest ones, are reborn, a trickle all the time and a burst of
+// BURST_FRACTION of the cloud on every beat. Band energies and the beat
+// pulse come from the AudioBlock.
+class ParticleSystem
+{
+public:
+	enum { MAX_PARTICLES = 1 << 24 };
+
+	ParticleSystem();
+	~ParticleSystem();
+
+	bool Init(int count, const char* updateShaderPath, const char* vertexShaderPath, const char* fragmentShaderPath);
+	// spawns and advances every particle; audio may be NULL
+	void Update(AnalysisFrame const* audio, double seconds);
+	void Draw();
+	// swap in a rebuilt sprite program, deleting the current one
+	void SetProgram(GLuint program);
+
+	int Count() const { return _count; }
+
+private:
+	GLuint _updateProgram;
+	GLuint _program;
+	GLuint _buffers[2];
+	GLuint _updateVaos[2];      // buffer i as per vertex input
+	GLuint _drawVaos[2];        // buffer i as per instance input
+	GLint  _particleCountID;
+	GLint  _spawnStartID;
+	GLint  _spawnCountID;
+	GLint  _spawnSpeedID;
+	GLint  _lifetimeID;
+	GLint  _seedID;
+	GLint  _sizeID;
+	int    _count;
+	int    _current;            // buffer holding the latest state
+	int    _spawnCursor;
+	double _spawnCarry;         // fraction of a particle owed to the next frame
+	uint32_t _lastSequence;
+	bool   _anySequence;        // _lastSequence is valid, sequences start at 0
+	double _lastTime;
+	uint32_t _frame;
+};
+
+#endif
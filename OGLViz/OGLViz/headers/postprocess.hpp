@@ -0,0 +1,81 @@
+#pragma once
+#ifndef POSTPROCESS_HPP
+#define POSTPROCESS_HPP
+
+#include "rendertargetpool.hpp"
+
+class ShaderManager;
+
+// Bloom and feedback trails over the rendered scene.
+//
+// The scene is drawn once into a window sized RGBA8 target (Begin), then
+// End runs the chain and composites into the output framebuffer:
+// - bloom: the scene is thresholded into a half size target and halved
+//   again down to BLOOM_LEVELS levels, each level blurred with a separable
+//   Gaussian (horizontal into a temporary, vertical back), all summed in
+//   the composite. Blurring small levels is what makes the glow wide.
+// - trails: a half size history, max(scene, previous history * decay),
+//   ping-ponged between two targets kept across frames.
+// - composite: scene, trails and bloom in one pass; the glow follows the
+//   bass band and the beat pulse from the AudioBlock.
+// Every intermediate comes from a RenderTargetPool, so after the first
+// frame nothing is allocated unless the window size changes, and each
+// pass is its own profiler scope.
+//
+//     GLuint target = post.Begin(width, height);
+//     scene.Render(...);               // or resolution.End(target)
+//     post.End();                      // into the window
+class PostProcess
+{
+public:
+	enum { BLOOM_LEVELS = 4 };
+	enum Pass { DOWNSAMPLE, BLUR, TRAILS, COMPOSITE, PASS_COUNT };
+
+	PostProcess();
+	~PostProcess();
+
+	// bloomStrength 0 leaves bloom out; trailPersistence is the fraction of
+	// a trail left after one second, 0 leaves trails out
+	bool Init(float bloomStrength, float trailPersistence);
+	// rebuild programs when their sources are saved
+	void Watch(ShaderManager& shaders);
+
+	// binds the scene target at the window size and returns it
+	GLuint Begin(int width, int height);
+	// runs the chain and composites into output, 0 for the window
+	void End(GLuint output = 0);
+
+	RenderTargetPool const& Pool() const { return _pool; }
+
+private:
+	struct Program
+	{
+		GLuint program;
+		GLint  texelSizeID;
+		GLint  thresholdID;
+		GLint  directionID;
+		GLint  persistenceID;
+		GLint  bloomStrengthID;
+		GLint  trailStrengthID;
+	};
+
+	void SetProgram(int pass, GLuint program);
+	bool AllocateScene(int width, int height);
+	void Bloom(RenderTarget* levels[BLOOM_LEVELS]);
+	void Trails();
+	void DrawInto(RenderTarget const* target);
+
+	Program _programs[PASS_COUNT];
+	GLuint  _vao;
+	GLuint  _sceneFramebuffer;
+	GLuint  _sceneColor;
+	GLuint  _sceneDepth;
+	int     _width, _height;
+	float   _bloomStrength;
+	float   _trailPersistence;
+	RenderTargetPool _pool;
+	RenderTarget* _history[2];      // trails, kept out of the pool between frames
+	int     _historyIndex;          // the one holding the latest trails
+};
+
+#endif
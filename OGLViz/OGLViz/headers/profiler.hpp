@@ -0,0 +1,94 @@
+#pragma once
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <chrono>
+
+// Per frame breakdown of named scopes, CPU and GPU.
+// CPU time is the steady clock around the scope. GPU time comes from a
+// GL_TIME_ELAPSED query per scope; queries are double buffered by frame and
+// only read back once GL reports them available, two frames later, so the
+// profiler never waits on the GPU (a result that is still not ready is
+// dropped and counted). Time elapsed queries cannot nest: a scope opened
+// inside another one is timed on the CPU only.
+//
+// The last WINDOW frames are kept; WriteCsv exports them as a trace plus
+// p50/p95/p99 per scope. Until Init is called every call is a no-op.
+// Scopes past MAX_SCOPES are not timed, and the first one is reported.
+//
+//     profiler.BeginFrame();
+//     { ProfileScope scope(profiler, "draw"); ... }
+//     profiler.EndFrame();
+class FrameProfiler
+{
+public:
+	enum { MAX_SCOPES = 32, QUERY_FRAMES = 2, WINDOW = 3600 };
+
+	FrameProfiler();
+
+	// needs a current context; the queries live as long as that context
+	bool Init();
+	bool Enabled() const { return _enabled; }
+
+	void BeginFrame();
+	void EndFrame();
+	// name must outlive the profiler, string literals are expected
+	int  Begin(const char* name);
+	void End(int scope);
+
+	// <prefix>_trace.csv: frame,scope,cpu_ms,gpu_ms for every kept frame
+	// <prefix>_summary.csv: scope,frames,cpu and gpu p50/p95/p99
+	bool WriteCsv(const char* prefix) const;
+	void PrintSummary() const;
+	// GPU results that were not ready when their slot came around again
+	unsigned Dropped() const { return _dropped; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Sample
+	{
+		float cpuMs;    // < 0 when the scope did not run that frame
+		float gpuMs;    // < 0 when unknown
+	};
+
+	int     FindScope(const char* name);
+	void    CollectQueries(int slot);
+	Sample& At(uint64_t frame, int scope) { return _samples[(frame % WINDOW) * MAX_SCOPES + scope]; }
+	Sample const& At(uint64_t frame, int scope) const { return _samples[(frame % WINDOW) * MAX_SCOPES + scope]; }
+	void    Percentiles(int scope, bool gpu, double out[3], int& count) const;
+
+	bool        _enabled;
+	uint64_t    _frame;                 // current frame, counted from 1
+	const char* _names[MAX_SCOPES];
+	int         _scopeCount;
+	Clock::time_point _frameStart;
+	Clock::time_point _start[MAX_SCOPES];
+	int         _openQuery;             // scope owning the running query, or -1
+	GLuint      _queries[QUERY_FRAMES][MAX_SCOPES];
+	bool        _issued[QUERY_FRAMES][MAX_SCOPES];
+	uint64_t    _queryFrame[QUERY_FRAMES];
+	std::vector<Sample> _samples;       // WINDOW x MAX_SCOPES ring
+	unsigned    _dropped;
+	bool        _rejected;              // a scope found no room, reported once
+};
+
+// times the enclosing block
+class ProfileScope
+{
+public:
+	ProfileScope(FrameProfiler& profiler, const char* name)
+		: _profiler(profiler), _scope(profiler.Begin(name)) {}
+	~ProfileScope() { _profiler.End(_scope); }
+
+private:
+	FrameProfiler& _profiler;
+	int            _scope;
+};
+
+// the profiler the render loop reports to
+FrameProfiler& frameProfiler();
+
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef RENDERSTATE_HPP
+#define RENDERSTATE_HPP
+
+#include <stdint.h>
+#include <unordered_map>
+
+// Thin shadow of the GL state the renderers touch: current program, VAO,
+// active unit and 2D texture per unit, depth/blend/cull enables, blend
+// function, depth mask and uniform values per program and location.
+// A call that would not change anything is dropped and counted.
+//
+// Draw code sets the state it needs instead of restoring what it changed.
+// Anything that changes this state with raw GL calls (loaders, third party
+// code) must be followed by Invalidate().
+class RenderState
+{
+public:
+	enum { MAX_UNITS = 16 };
+	enum Cap { DEPTH_TEST, BLEND, CULL_FACE, CAP_COUNT };
+
+	RenderState();
+
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vao);
+	// GL_TEXTURE_2D; always leaves unit active, so uploads after it go to texture
+	void BindTexture(int unit, GLuint texture);
+	void Set(Cap cap, bool enabled);
+	void BlendFunc(GLenum src, GLenum dst);
+	void DepthMask(bool write);
+
+	// on the current program
+	void Uniform1i(GLint location, GLint value);
+	void Uniform1f(GLint location, GLfloat value);
+	void Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+
+	// forget everything, the next call of each kind goes to GL
+	void Invalidate();
+	// drop cached uniforms of a deleted or relinked program
+	void ForgetProgram(GLuint program);
+
+	uint64_t Issued() const { return _issued; }
+	uint64_t Elided() const { return _elided; }
+	void ResetCounters() { _issued = _elided = 0; }
+
+private:
+	struct UniformValue
+	{
+		uint32_t bits[4];
+	};
+
+	bool Changed(GLint location, UniformValue const& value);
+	void ActiveTexture(int unit);
+
+	GLuint _program;
+	GLuint _vao;
+	int    _activeUnit;
+	GLuint _textures[MAX_UNITS];
+	int    _caps[CAP_COUNT];          // -1 unknown, 0 off, 1 on
+	GLenum _blendSrc;
+	GLenum _blendDst;
+	int    _depthMask;
+	std::unordered_map<uint64_t, UniformValue> _uniforms;   // program << 32 | location
+
+	uint64_t _issued;
+	uint64_t _elided;
+};
+
+// the one context's state
+RenderState& glState();
+
+#endif
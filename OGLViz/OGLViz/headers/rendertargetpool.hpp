@@ -0,0 +1,51 @@
+#pragma once
+#ifndef RENDERTARGETPOOL_HPP
+#define RENDERTARGETPOOL_HPP
+
+// A colour-only framebuffer with its texture, handed out by the pool.
+struct RenderTarget
+{
+	GLuint framebuffer;
+	GLuint texture;
+	int    width;
+	int    height;
+	bool   inUse;
+	bool   touched;     // acquired since the last Trim
+};
+
+// Colour targets for intermediate passes, recycled by size instead of
+// being created per pass. All are GL_R11F_G11F_B10F: unclamped like a
+// half float target at a third of the bandwidth, which is what repeated
+// blurs and slow decays need, and linear filtered with clamped edges.
+//
+// Acquire gives a free target of the exact size, creating one only when
+// none is free. A target stays out until Released, so a pass can keep one
+// across frames. Trim once per frame deletes targets nobody asked for
+// since the previous Trim, which is how sizes left behind by a window
+// resize go away.
+class RenderTargetPool
+{
+public:
+	enum { MAX_TARGETS = 24 };
+
+	RenderTargetPool();
+	~RenderTargetPool();
+
+	// NULL when the pool is full or the framebuffer can't be completed
+	RenderTarget* Acquire(int width, int height);
+	void Release(RenderTarget* target);
+	void Trim();
+
+	int Allocated() const { return _allocated; }
+	unsigned Created() const { return _created; }
+
+private:
+	bool Create(RenderTarget& target, int width, int height);
+	void Destroy(RenderTarget& target);
+
+	RenderTarget _targets[MAX_TARGETS];
+	int      _allocated;
+	unsigned _created;
+};
+
+#endif
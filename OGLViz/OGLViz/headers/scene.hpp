@@ -0,0 +1,67 @@
+#pragma once
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "analysisframe.hpp"
+#include "mesh.hpp"
+#include "spectrumbars.hpp"
+#include "spectrogram.hpp"
+#include "particles.hpp"
+#include "waveform.hpp"
+#include "uniformblocks.hpp"
+
+class ShaderManager;
+
+// Everything drawn in a frame: the textured mesh, the particle cloud, the
+// spectrum bars, the spectrogram and the oscilloscope trace, plus the uniform blocks feeding them. The window loop and
+// the headless runner only differ in where the camera, the audio and the
+// framebuffer come from.
+class Scene
+{
+public:
+	enum { MAX_BARS = 4096, SPECTROGRAM_COLUMNS = 512 };
+
+	Scene();
+	~Scene();
+
+	// historyRows = 0 leaves the spectrogram out, particleCount = 0 the particles
+	bool Init(int barCount, int historyRows, int particleCount);
+	// bars from a GPU computed intensity texture (GpuFft) instead of the
+	// analysis frame's spectrum; call after Init, before Watch
+	bool UseSpectrumTexture(GLuint spectrum, int binCount);
+	// oscilloscope trace of windowSamples raw samples, fed by PushSamples;
+	// triggered holds periodic waves still. Call after Init, before Watch
+	bool UseWaveform(int windowSamples, bool triggered);
+	// the newest raw samples, in the recorder's 16-bit scale
+	void PushSamples(const float* samples, int count);
+	// an analysis frame as it arrived, not smoothed: one spectrogram row each
+	void PushFrame(AnalysisFrame const& frame);
+	// rebuild programs when their sources are saved
+	void Watch(ShaderManager& shaders);
+	// clears and draws into the bound framebuffer; audio may be NULL
+	void Render(glm::mat4 const& projection, glm::mat4 const& view, AnalysisFrame const* audio,
+		double seconds, int width, int height);
+
+	SpectrumBars const& Bars() const { return _bars; }
+	Waveform const& Trace() const { return _waveform; }
+
+private:
+	GLuint        _program;
+	GLint         _textureID;
+	GLuint        _texture;
+	Mesh          _mesh;
+	SpectrumBars  _bars;
+	Spectrogram   _spectrogram;
+	ParticleSystem _particles;
+	Waveform      _waveform;
+	UniformBlocks _uniforms;
+	int           _barCount;
+	int           _historyRows;
+	int           _particleCount;
+	GLuint        _spectrum;
+	int           _spectrumBins;
+	int           _waveformWindow;
+	double        _lastTime;
+};
+
+#endif
@@ -3,4 +3,12 @@
 
 GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path);
 
+// Vertex shader only program whose outputs, in the given order, are
+// captured interleaved by transform feedback. Not cached.
+GLuint LoadFeedbackShader(const char* vertex_file_path, const char* const* varyings, int varyingCount);
+
+// Linked programs are cached as driver binaries in this directory, which
+// must exist; NULL (the default) compiles from source every time.
+void setShaderCacheDirectory(const char* directory);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef SHADERMANAGER_HPP
+#define SHADERMANAGER_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct GLFWwindow;
+
+// Shader hot reload.
+// Watched source files are checked for a new modification time a few times
+// a second. A changed program is rebuilt off the frame: with
+// KHR_parallel_shader_compile the driver compiles in its own threads and the
+// link status is polled once per frame, otherwise a worker thread builds it
+// on a hidden context sharing objects with the window. Only a program that
+// compiled and linked is handed to its owner; on failure the old one stays
+// in use and the log is kept in LastError().
+class ShaderManager
+{
+public:
+	// new program, already linked and with its uniform blocks bound; the
+	// owner re-queries uniform locations and deletes the program it replaces
+	typedef std::function<void(GLuint program)> SwapCallback;
+
+	ShaderManager();
+	~ShaderManager();
+
+	// shareWith: window whose context the worker shares, may be NULL
+	bool Init(GLFWwindow* shareWith);
+	void Watch(const char* vertexPath, const char* fragmentPath, SwapCallback onSwap);
+	// once per frame on the render thread
+	void Update();
+
+	std::string const& LastError() const { return _lastError; }
+	unsigned Reloads() const { return _reloads; }
+	unsigned Failures() const { return _failures; }
+
+private:
+	struct Build
+	{
+		GLuint program;
+		GLuint vertexShader;
+		GLuint fragmentShader;
+	};
+
+	struct Entry
+	{
+		std::string  vertexPath;
+		std::string  fragmentPath;
+		SwapCallback onSwap;
+		uint64_t     vertexTime;
+		uint64_t     fragmentTime;
+		bool         building;
+		bool         dirty;        // changed again while building
+		Build        build;        // parallel compile in flight
+	};
+
+	struct Job
+	{
+		size_t      entry;
+		std::string vertexPath;
+		std::string fragmentPath;
+	};
+
+	struct Result
+	{
+		size_t      entry;
+		GLuint      program;       // 0 on failure
+		std::string log;
+	};
+
+	void PollFiles();
+	void StartBuild(size_t index);
+	void Finish(Result& result);
+	void WorkerLoop();
+
+	std::vector<Entry> _entries;
+	bool        _parallel;         // KHR_parallel_shader_compile
+	GLFWwindow* _workerWindow;     // hidden, shares with the main window
+	double      _lastPoll;
+
+	std::thread             _worker;
+	std::mutex              _mutex;
+	std::condition_variable _wake;
+	std::deque<Job>         _jobs;
+	std::deque<Result>      _done;
+	bool                    _quit;
+
+	std::string _lastError;
+	unsigned    _reloads;
+	unsigned    _failures;
+};
+
+#endif
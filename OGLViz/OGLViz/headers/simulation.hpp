@@ -0,0 +1,108 @@
+#pragma once
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#include "analysisframe.hpp"
+#include "control.hpp"
+
+class SpectrumBusReader;
+class SpectrumReceiver;
+
+// Everything the scene animates, as of one simulation tick.
+// audio carries the newest analysis frame with its spectrum and band
+// energies smoothed (fast attack, slow release) tick by tick.
+struct SimulationState
+{
+	uint64_t      tick;
+	double        time;         // tick / rate, seconds
+	CameraState   camera;
+	bool          hasAudio;
+	AnalysisFrame audio;
+};
+
+// Fixed rate simulation, decoupled from the render rate.
+// Each tick consumes the newest analysis frame and the input gathered since
+// the previous tick, then advances the camera and the audio smoothing by
+// exactly 1 / rate seconds, so the result depends only on the tick count.
+// Started, it runs on its own thread and polls the bus / receiver itself;
+// the render thread draws Interpolate(Now() - Delay()), a blend of the two
+// newest ticks, so motion stays smooth when the render rate drops or beats
+// against the tick rate. Without Start, Step drives it synchronously.
+class Simulation
+{
+public:
+	enum { DEFAULT_RATE = 240, MAX_CATCH_UP = 8, RECEIVED_FRAMES = 8 };
+
+	Simulation();
+	~Simulation();
+
+	void Reset(double rate, CameraState const& camera);
+	// one tick; audio is the newest analysis frame or NULL for no news
+	void Step(ControlInput const& input, AnalysisFrame const* audio);
+
+	// run ticks on a thread from now on, reading analysis from bus and/or
+	// receiver (either may be NULL); the thread owns them until Stop
+	bool Start(SpectrumBusReader* bus, SpectrumReceiver* receiver);
+	void Stop();
+	// main thread: input since the last push, added up until a tick takes it
+	void PushInput(ControlInput const& input);
+
+	// seconds on the simulation clock, since Start
+	double Now() const;
+	// how far behind Now() to render so two ticks surround the render time
+	double Delay() const { return 1.0 / _rate; }
+	// state at seconds, clamped to the two newest ticks. Its beatFlags are
+	// those of every frame consumed since the previous call, so a beat on a
+	// frame that arrived between two renders still reaches the next one
+	void Interpolate(double seconds, SimulationState& out);
+	// render thread: the oldest analysis frame the thread received and the
+	// renderer has not taken yet, unsmoothed; false when there is none.
+	// Only the newest RECEIVED_FRAMES are kept
+	bool TakeReceived(AnalysisFrame& out);
+
+	double   Rate() const { return _rate; }
+	uint64_t Ticks() const;
+	// ticks dropped because the thread fell more than MAX_CATCH_UP behind
+	uint64_t Skipped() const { return _skipped; }
+
+private:
+	void ThreadLoop();
+	void Keep(AnalysisFrame const& frame);
+
+	double           _rate;
+	// three states: previous and current are read by Interpolate, the
+	// third is written by the next tick and only then rotated in
+	SimulationState  _states[3];
+	int              _previous;
+	int              _current;
+	mutable std::mutex _stateLock;
+
+	AnalysisFrame    _latest;       // newest raw frame
+	bool             _hasLatest;
+	uint32_t         _unreadBeats;  // beat flags consumed since Interpolate, under _stateLock
+	AnalysisFrame    _received;     // thread only, read from the bus or receiver
+
+	// frames as received, a ring for TakeReceived
+	std::mutex       _keptLock;
+	AnalysisFrame    _kept[RECEIVED_FRAMES];
+	uint64_t         _keptCount;
+	uint64_t         _takenCount;
+
+	std::mutex       _inputLock;
+	ControlInput     _pendingInput;
+
+	SpectrumBusReader* _bus;
+	SpectrumReceiver*  _receiver;
+	std::thread      _thread;
+	std::atomic<bool> _running;
+	std::chrono::steady_clock::time_point _start;
+	uint64_t         _skipped;
+};
+
+#endif
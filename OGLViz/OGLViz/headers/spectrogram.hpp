@@ -0,0 +1,48 @@
+#pragma once
+#ifndef SPECTROGRAM_HPP
+#define SPECTROGRAM_HPP
+
+#include <vector>
+
+#include "analysisframe.hpp"
+#include "streambuffer.hpp"
+
+// Scrolling waterfall of the spectrum history.
+// The history is a rows x columns R8 texture used as a ring: each new
+// analysis frame writes exactly one row (through a pixel unpack StreamBuffer)
+// and advances the ring offset, and the shader reads rows relative to that
+// offset, so nothing already uploaded is ever moved or re-sent. Upload cost
+// is one row, O(bins), whatever the history length.
+class Spectrogram
+{
+public:
+	Spectrogram();
+	~Spectrogram();
+
+	// columns are log spaced from the first bin to Nyquist
+	bool Init(int rows, int columns, const char* vertexShaderPath, const char* fragmentShaderPath);
+	// adds a row when frame is newer than the last one seen
+	void Update(AnalysisFrame const& frame);
+	// panel in normalized device coordinates
+	void Draw(float left, float bottom, float right, float top);
+	// swap in a rebuilt program, deleting the current one
+	void SetProgram(GLuint program);
+
+private:
+	GLuint   _program;
+	GLuint   _vao;
+	GLuint   _texture;
+	GLint    _rectID;
+	GLint    _newestID;
+	GLint    _historyID;
+	StreamBuffer _rows;         // unpack buffer, one texture row per region
+	int      _rowCount;
+	int      _columns;
+	int      _newest;           // texture row holding the latest frame
+	uint32_t _lastSequence;
+	uint32_t _edgeBins;         // binCount _edges was built for
+	std::vector<int> _edges;    // first bin of each column, plus the end
+	bool     _any;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef SPECTRUMBARS_HPP
+#define SPECTRUMBARS_HPP
+
+#include "analysisframe.hpp"
+#include "streambuffer.hpp"
+
+// Spectrum display drawn as instances of one unit bar:
+// the mesh lives in a VAO, each frame only the per-bar height and colour
+// are written into a StreamBuffer region, and all bars go out in a single
+// glDrawArraysInstanced.
+// With a spectrum texture as the source (GpuFft) nothing is uploaded at
+// all: the vertex shader finds each bar's bins and height itself.
+class SpectrumBars
+{
+public:
+	SpectrumBars();
+	~SpectrumBars();
+
+	bool Init(int maxBars, const char* vertexShaderPath, const char* fragmentShaderPath);
+	// bars are log spaced from the first bin to Nyquist
+	void Update(AnalysisFrame const& frame, int barCount);
+	void Draw();
+	// swap in a rebuilt program, deleting the current one
+	void SetProgram(GLuint program);
+
+	bool InitTextureSource(const char* vertexShaderPath, const char* fragmentShaderPath);
+	// bars from an R32F intensity per bin texture until the next Update
+	void UpdateFromTexture(GLuint spectrum, int binCount, int barCount);
+	void SetTextureProgram(GLuint program);
+
+	StreamBuffer const& Stream() const { return _stream; }
+
+private:
+	struct BarInstance
+	{
+		float         height;     // 0..1 of the viewport height
+		unsigned char color[4];   // RGBA8, normalized in the shader
+	};
+
+	GLuint _program;
+	GLuint _vao;
+	GLuint _meshBuffer;
+	StreamBuffer _stream;     // per-bar instances
+	GLint  _barCountID;
+	GLuint _textureProgram;
+	GLuint _textureVao;       // corners only, no instance attributes
+	GLint  _textureBarCountID;
+	GLint  _binCountID;
+	GLuint _spectrum;         // 0 while the bars come from Update
+	int    _binCount;
+	int    _maxBars;
+	int    _barCount;
+	int    _streamedCount;    // bars in the region the vertex attributes point at
+};
+
+#endif
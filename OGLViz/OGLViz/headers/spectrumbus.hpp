@@ -0,0 +1,87 @@
+#pragma once
+#ifndef SPECTRUMBUS_HPP
+#define SPECTRUMBUS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "analysisframe.hpp"
+
+// Shared-memory ring of AnalysisFrames: one analysis process publishes,
+// any number of render processes attach read-only.
+//
+// Every slot carries a sequence counter (seqlock): odd while the writer is
+// filling it, 2*n+2 once frame n is complete. Readers copy the frame out of
+// the mapping and check the counter again afterwards; if the writer has
+// lapped the ring meanwhile the copy may be torn and is discarded. One copy
+// on the reader side, no syscalls per frame on either side.
+
+enum { BUS_SLOTS = 16 };
+
+struct SpectrumBusSlot
+{
+	std::atomic<uint64_t> seq;
+	AnalysisFrame         frame;
+};
+
+struct SpectrumBusHeader
+{
+	uint32_t              magic;
+	uint32_t              version;
+	uint32_t              slotCount;
+	uint32_t              frameSize;
+	std::atomic<uint64_t> published;    // frames written so far
+	SpectrumBusSlot       slots[BUS_SLOTS];
+};
+
+class SharedMapping
+{
+public:
+	SharedMapping() : _base(0), _size(0), _handle(0), _owner(false) { _name[0] = 0; }
+	~SharedMapping() { Close(); }
+	bool  Open(const char* name, size_t size, bool create);
+	void  Close();
+	void* Base() const { return _base; }
+private:
+	void*  _base;
+	size_t _size;
+	void*  _handle;      // file mapping handle on Windows
+	bool   _owner;
+	char   _name[72];
+};
+
+class SpectrumBusWriter
+{
+public:
+	SpectrumBusWriter() : _bus(0) {}
+	// creates (or takes over) the named segment
+	bool Create(const char* name);
+	void Publish(AnalysisFrame const& frame);
+	// fill a slot in place instead of copying a finished frame
+	AnalysisFrame& Begin();
+	void Commit();
+private:
+	SharedMapping      _map;
+	SpectrumBusHeader* _bus;
+};
+
+class SpectrumBusReader
+{
+public:
+	SpectrumBusReader() : _bus(0), _lastSeen(0), _dropped(0) {}
+	bool Attach(const char* name);
+
+	// Copies the newest complete frame into out; false when nothing new was
+	// published since the previous call or the writer lapped the copy.
+	bool Read(AnalysisFrame& out);
+
+	uint64_t Dropped() const { return _dropped; }
+private:
+	SharedMapping      _map;
+	SpectrumBusHeader* _bus;
+	uint64_t           _lastSeen;
+	uint64_t           _dropped;   // frames published but never seen
+};
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef STEREO_HPP
+#define STEREO_HPP
+
+#include <atomic>
+
+#include "analysisframe.hpp"
+
+// Decimated goniometer points for the vectorscope.
+// Single producer (capture thread), single consumer.
+// Points are (side, mid) pairs, i.e. L/R rotated by 45 degrees, stored
+// as interleaved floats so a span can go straight into a vertex buffer.
+class VectorscopeRing
+{
+public:
+	enum { CAPACITY = 8192 };   // points, power of two
+
+	VectorscopeRing() : _written(0) {}
+
+	// count interleaved points, wrapping at the end of the ring
+	void Push(const float* points, int count);
+
+	// The newest count points as at most two contiguous spans (oldest
+	// first); the second span is empty unless the ring wrapped.
+	// Returns the number of points.
+	int Newest(int count, const float*& first, int& firstCount, const float*& second, int& secondCount) const;
+
+	unsigned long long Written() const { return _written.load(std::memory_order_acquire); }
+
+private:
+	std::atomic<unsigned long long> _written;
+	float _points[2 * CAPACITY];
+};
+
+// Stereo image of whole de-interleaved buffers: correlation, balance,
+// mid/side energy, plus vectorscope points every DECIMATION samples.
+// Energies are smoothed across buffers so meters don't flicker.
+// The newest SCOPE_POINTS points go out with every frame, so the render
+// side gets them wherever the frame goes (the bus, the simulation).
+// The network stream does not carry them: received frames have none.
+class StereoAnalyzer
+{
+public:
+	enum { DECIMATION = 4 };
+
+	StereoAnalyzer(float smoothing = 0.8f);
+
+	void Process(const float* left, const float* right, int count, AnalysisFrame& frame);
+
+	VectorscopeRing const& Scope() const { return _scope; }
+
+private:
+	void Decimate(const float* left, const float* right, int count);
+
+	float _smoothing;
+	float _ll, _rr, _lr;    // smoothed mean squares / cross term
+	VectorscopeRing _scope;
+};
+
+#endif
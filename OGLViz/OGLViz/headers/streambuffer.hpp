@@ -0,0 +1,62 @@
+#pragma once
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+#include <stddef.h>
+
+// Triple-buffered ring for data rewritten every frame (spectrum, waveform,
+// particles, per frame uniforms).
+//
+// With GL 4.4 / ARB_buffer_storage the buffer is mapped once, persistent
+// and coherent, and writes go straight into the region the GPU is not
+// reading. Otherwise each region is mapped with INVALIDATE_RANGE |
+// UNSYNCHRONIZED. Every region is fenced after the draws that read it; if
+// the fence has not passed when the ring comes back around, the fallback
+// path orphans the whole buffer instead of waiting. The persistent storage
+// can't be orphaned, so there Map returns 0 and counts a skip: the caller
+// keeps drawing from the region it wrote last time, and the CPU never
+// waits on the GPU (three regions make that rare).
+//
+//     void* p = stream.Map(bytes);   // write up to RegionSize() bytes, or 0: skip
+//     size_t offset = stream.Unmap();
+//     ... point attributes / glBindBufferRange at offset, draw ...
+//     stream.Fence();                // after the draws reading that region
+class StreamBuffer
+{
+public:
+	enum { REGIONS = 3 };
+
+	StreamBuffer();
+	~StreamBuffer();
+
+	// regionSize is rounded up to alignment (use the UBO offset alignment
+	// for uniform buffers). allowPersistent=false forces the fallback path.
+	bool   Init(GLenum target, size_t regionSize, size_t alignment = 256, bool allowPersistent = true);
+
+	void*  Map(size_t size);
+	size_t Unmap();
+	void   Fence();
+
+	GLuint Buffer() const { return _buffer; }
+	GLenum Target() const { return _target; }
+	size_t RegionSize() const { return _regionSize; }
+	bool   Persistent() const { return _persistent != 0; }
+	// uploads skipped because the GPU still read the region / times the buffer was orphaned
+	unsigned Skips() const { return _skips; }
+	unsigned Orphans() const { return _orphans; }
+
+private:
+	bool   WaitRegion();
+
+	GLenum   _target;
+	GLuint   _buffer;
+	size_t   _regionSize;
+	int      _region;              // next region to write
+	int      _last;                // region handed out by the last Unmap
+	char*    _persistent;          // whole buffer, when persistently mapped
+	GLsync   _fences[REGIONS];
+	unsigned _skips;
+	unsigned _orphans;
+};
+
+#endif
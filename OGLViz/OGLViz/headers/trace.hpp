@@ -0,0 +1,77 @@
+#pragma once
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// Timeline tracing across the capture, analysis and render threads,
+// written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Every thread appends to its own event ring, single writer, no locks; the
+// ring is allocated and registered on the thread's first event while
+// recording, so threads that never record cost nothing. A full ring
+// overwrites its oldest events and the dump keeps the newest ones, counting
+// the rest. Scopes become one complete ("X") event written when they close. Timestamps are the steady
+// clock, the same clock AnalysisFrame::captureTimeNs uses, and the pid is
+// the process id, so traces of a publisher and a renderer can be merged.
+//
+// Recording is off until traceStart(); until then a scope costs one relaxed
+// load. Build with OGLVIZ_TRACE=0 and the macros compile to nothing.
+//
+//     TRACE_SCOPE("Fft::Transform");
+//     TRACE_INSTANT("Recorder::BufferDone");
+//     TRACE_THREAD_NAME("shader worker");
+
+#ifndef OGLVIZ_TRACE
+#define OGLVIZ_TRACE 1
+#endif
+
+#include <stdint.h>
+
+// false when built without tracing
+bool traceStart();
+// everything recorded so far; threads may keep recording meanwhile
+bool traceWrite(const char* path);
+
+#if OGLVIZ_TRACE
+
+#include <atomic>
+
+extern std::atomic<bool> traceActive;
+
+uint64_t traceNow();
+// names must stay valid until traceWrite, string literals are expected
+void traceComplete(const char* name, uint64_t startNs, uint64_t endNs);
+void traceInstant(const char* name);
+void traceThreadName(const char* name);
+
+class TraceScope
+{
+public:
+	TraceScope(const char* name)
+		: _name(name), _start(traceActive.load(std::memory_order_relaxed) ? traceNow() : 0) {}
+	~TraceScope()
+	{
+		if (_start != 0)
+			traceComplete(_name, _start, traceNow());
+	}
+
+private:
+	const char* _name;
+	uint64_t    _start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_INSTANT(name) \
+	do { if (traceActive.load(std::memory_order_relaxed)) traceInstant(name); } while (0)
+#define TRACE_THREAD_NAME(name) traceThreadName(name)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+
+#endif
+
+#endif
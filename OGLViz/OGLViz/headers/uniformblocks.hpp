@@ -0,0 +1,64 @@
+#pragma once
+#ifndef UNIFORMBLOCKS_HPP
+#define UNIFORMBLOCKS_HPP
+
+#include "analysisframe.hpp"
+#include "streambuffer.hpp"
+
+// Per frame state shared by every shader program as std140 uniform blocks
+// at fixed binding points, written once per frame instead of once per
+// program and uniform. A shader picks them up by declaring
+//
+//     layout(std140) uniform FrameBlock { ... };   // binding FRAME_BINDING
+//     layout(std140) uniform AudioBlock { ... };   // binding AUDIO_BINDING
+//
+// with members in the order below; LoadShaders binds them when present.
+enum { FRAME_BINDING = 0, AUDIO_BINDING = 1 };
+
+struct FrameUniforms
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::mat4 model;
+	glm::mat4 mvp;
+	glm::vec4 lightPosition;    // world space, w unused
+	glm::vec4 viewport;         // width, height, seconds, seconds since last frame
+};
+
+struct AudioUniforms
+{
+	glm::vec4 bands[NUM_BANDS / 4];  // band i is bands[i / 4][i % 4], 0..1 in dB like the bars
+	float beatPulse;            // 1 on a beat onset, decaying towards 0
+	float secondsSinceBeat;
+	float momentaryLufs;
+	float shortTermLufs;
+	float rmsDb;
+	float peakDb;
+	float correlation;
+	float balance;
+};
+
+// point the blocks a program declares at their binding points
+void bindUniformBlocks(GLuint program);
+
+class UniformBlocks
+{
+public:
+	UniformBlocks();
+
+	bool Init();
+	// audio may be NULL before the first analysis frame arrives
+	void Update(FrameUniforms const& frame, AnalysisFrame const* audio, double seconds);
+	// after the last draw of the frame
+	void EndFrame() { _stream.Fence(); }
+
+private:
+	StreamBuffer  _stream;
+	size_t        _audioOffset;  // FrameUniforms rounded up to the offset alignment
+	AudioUniforms _audio;
+	uint32_t      _lastSequence;
+	bool          _anySequence;  // _lastSequence is valid, sequences start at 0
+	double        _lastBeat;
+};
+
+#endif
@@ -0,0 +1,11 @@
+#pragma once
+#ifndef UPLOADBENCH_HPP
+#define UPLOADBENCH_HPP
+
+// Streams the same per-frame payload through each upload path (glBufferData,
+// orphan + glBufferSubData, StreamBuffer unsynchronized and persistent),
+// has the GPU read every upload, and prints MB/s per path and size.
+// Needs a current context. Returns the process exit code.
+int runUploadBenchmark(int frames);
+
+#endif
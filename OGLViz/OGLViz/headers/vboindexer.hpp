@@ -2,6 +2,8 @@
 #ifndef VBOINDEXER_HPP
 #define VBOINDEXER_HPP
 
+// unsigned short indices wrap past 65536 unique vertices,
+// use the unsigned int version for anything that may be larger
 void indexVBO(
 	std::vector<glm::vec3>& in_vertices,
 	std::vector<glm::vec2>& in_uvs,
@@ -13,6 +15,17 @@ void indexVBO(
 	std::vector<glm::vec3>& out_normals
 );
 
+void indexVBO(
+	std::vector<glm::vec3>& in_vertices,
+	std::vector<glm::vec2>& in_uvs,
+	std::vector<glm::vec3>& in_normals,
+
+	std::vector<unsigned int>& out_indices,
+	std::vector<glm::vec3>& out_vertices,
+	std::vector<glm::vec2>& out_uvs,
+	std::vector<glm::vec3>& out_normals
+);
+
 
 void indexVBO_TBN(
 	std::vector<glm::vec3>& in_vertices,
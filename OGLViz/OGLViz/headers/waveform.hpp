@@ -0,0 +1,75 @@
+#pragma once
+#ifndef WAVEFORM_HPP
+#define WAVEFORM_HPP
+
+#include <stdint.h>
+#include <vector>
+
+// Oscilloscope trace of the raw samples, seconds long if need be, drawn
+// as one min/max span per pixel column instead of one vertex per sample.
+//
+// Samples go into a min/max pyramid: level 0 holds the samples themselves
+// (min = max), level k the min and max of 2^k of them, each level a ring
+// of capacity >> k entries. Append completes a level k entry every 2^k
+// samples, so building the pyramid is amortized O(1) per sample. All levels
+// live in one RG32F texture, ROW entries to a texture row, level after
+// level. Draw picks the coarsest level with at most one entry per pixel
+// column and uploads only that level's entries completed since it was
+// last drawn, in at most a few row pieces; one instanced draw then turns
+// every column into a quad spanning the min and max of its entries.
+//
+// Triggered, the window starts at the latest rising zero crossing (with
+// hysteresis, so noise around zero cannot fire it) that still leaves a
+// whole window of history after it, which holds a periodic wave still on
+// screen. Without one in reach it free-runs on the newest samples.
+class Waveform
+{
+public:
+	enum { ROW = 1024, MAX_LEVELS = 24 };
+
+	Waveform();
+	~Waveform();
+
+	// keeps the newest capacity samples, rounded up to a power of 2 no smaller than ROW
+	bool Init(int capacity, const char* vertexShaderPath, const char* fragmentShaderPath);
+	// in the recorder's 16-bit scale like Fft::CopyIn
+	void Append(const float* samples, int count);
+	// samples across the panel, at most half the capacity when triggered
+	void SetWindow(int samples, bool triggered);
+	// panel in normalized device coordinates, over a width x height pixel target
+	void Draw(float left, float bottom, float right, float top, int width, int height);
+	// swap in a rebuilt program, deleting the current one
+	void SetProgram(GLuint program);
+
+	int      Capacity() const { return _capacity; }
+	int      Level() const { return _level; }
+	// pyramid entries sent to the texture so far
+	uint64_t Uploaded() const { return _uploadedEntries; }
+	// draws that found a trigger, out of the triggered draws
+	unsigned Triggers() const { return _triggers; }
+	unsigned TriggeredDraws() const { return _triggeredDraws; }
+
+private:
+	void    Upload(int level);
+	int64_t FindTrigger(int64_t earliest, int64_t latest) const;
+
+	GLuint   _program;
+	GLuint   _vao;
+	GLuint   _texture;
+	GLint    _rectID, _columnsID, _windowID, _firstID, _levelID, _levelRowID, _levelMaskID, _rowWidthID;
+	GLint    _gainID, _pixelHeightID;
+	int      _capacity;
+	int      _levelCount;
+	int      _rowStart[MAX_LEVELS];      // first texture row of each level
+	std::vector<float> _levels[MAX_LEVELS]; // min, max pairs, ring of capacity >> k
+	uint64_t _written;                   // samples appended
+	uint64_t _uploaded[MAX_LEVELS];      // entries of each level in the texture
+	uint64_t _uploadedEntries;
+	int      _window;
+	bool     _triggered;
+	int      _level;                     // level of the last draw
+	unsigned _triggers;
+	unsigned _triggeredDraws;
+};
+
+#endif
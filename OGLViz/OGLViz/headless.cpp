@@ -0,0 +1,455 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include <GL\\glew.h>
+#if defined(OGLVIZ_EGL)
+#include <EGL\\egl.h>
+#include <EGL\\eglext.h>
+#elif defined(OGLVIZ_OSMESA)
+#include <GL\\osmesa.h>
+#else
+#include <GLFW\\glfw3.h>
+#endif
+#include <GLM\\glm\\glm.hpp>
+#include <GLM\\glm\\gtc\\matrix_transform.hpp>
+
+#include "headers\\gpufft.hpp"
+#include "headers\\offlineanalysis.hpp"
+#include "headers\\audiosource.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\scene.hpp"
+#include "headers\\profiler.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\control.hpp"
+#include "headers\\simulation.hpp"
+#include "headers\\dynamicresolution.hpp"
+#include "headers\\postprocess.hpp"
+#include "headers\\framecapture.hpp"
+#include "headers\\headless.hpp"
+
+static const int FFT_POINTS = 4096;
+// camera orbit, radians per second of rendered time
+static const float ORBIT_RATE = 0.3f;
+// frames between GPU FFT readbacks, and the error allowed relative to the spectrum peak
+static const int GPU_FFT_CHECK_INTERVAL = 30;
+static const double GPU_FFT_TOLERANCE = 1e-4;
+// render size over output size is 1, 2 or 4
+static const int MAX_SUPERSAMPLE_LEVELS = 3;
+// frames an export analyses in front of the one being drawn
+static const int ANALYSIS_AHEAD = 8;
+
+// Context creation per backend, picked at build time (HeadlessBackend in
+// the project, see headless.hpp). Only one of these is compiled.
+#if defined(OGLVIZ_EGL)
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLContext context = EGL_NO_CONTEXT;
+
+static bool createContext(int, int) {
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != NULL)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+		fprintf(stderr, "Failed to initialize EGL\n");
+		return false;
+	}
+	eglBindAPI(EGL_OPENGL_API);
+	const EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	// no config and no surface: everything is drawn into our own framebuffer
+	context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		fprintf(stderr, "Failed to create a surfaceless OpenGL 3.3 context (EGL error 0x%x)\n", eglGetError());
+		return false;
+	}
+	return true;
+}
+
+static void destroyContext() {
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != EGL_NO_CONTEXT)
+		eglDestroyContext(display, context);
+	eglTerminate(display);
+}
+
+#elif defined(OGLVIZ_OSMESA)
+
+static OSMesaContext context = NULL;
+// OSMesa wants a colour buffer to make current; the frames go to the FBO
+static unsigned char osmesaBuffer[16 * 16 * 4];
+
+static bool createContext(int, int) {
+	const int attributes[] = {
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_DEPTH_BITS, 0,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 3,
+		OSMESA_CONTEXT_MINOR_VERSION, 3,
+		0
+	};
+	context = OSMesaCreateContextAttribs(attributes, NULL);
+	if (context == NULL || !OSMesaMakeCurrent(context, osmesaBuffer, GL_UNSIGNED_BYTE, 16, 16)) {
+		fprintf(stderr, "Failed to create an OSMesa OpenGL 3.3 core context\n");
+		return false;
+	}
+	return true;
+}
+
+static void destroyContext() {
+	if (context != NULL)
+		OSMesaDestroyContext(context);
+}
+
+#else
+
+static GLFWwindow* hiddenWindow = NULL;
+
+static bool createContext(int width, int height) {
+	if (!glfwInit()) {
+		fprintf(stderr, "Failed to initialize GLFW\n");
+		return false;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	hiddenWindow = glfwCreateWindow(width, height, "LIQUIDSTATE headless", NULL, NULL);
+	if (hiddenWindow == NULL) {
+		fprintf(stderr, "Failed to create a hidden OpenGL 3.3 window\n");
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(hiddenWindow);
+	return true;
+}
+
+static void destroyContext() {
+	glfwTerminate();
+}
+
+#endif
+
+// color + depth renderbuffers at the requested size
+struct OffscreenTarget
+{
+	GLuint framebuffer;
+	GLuint color;
+	GLuint depth;
+};
+
+static bool createTarget(OffscreenTarget& target, int width, int height) {
+	glGenRenderbuffers(1, &target.color);
+	glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &target.depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glGenFramebuffers(1, &target.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Offscreen framebuffer incomplete (0x%x)\n", status);
+		return false;
+	}
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+static void destroyTarget(OffscreenTarget& target) {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &target.framebuffer);
+	glDeleteRenderbuffers(1, &target.color);
+	glDeleteRenderbuffers(1, &target.depth);
+}
+
+// nearest rank on sorted times
+static double percentile(std::vector<double> const& sorted, double p) {
+	size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void printStatistics(const char* label, std::vector<double> times) {
+	if (times.empty())
+		return;
+	std::sort(times.begin(), times.end());
+	double sum = 0;
+	for (size_t i = 0; i < times.size(); i++)
+		sum += times[i];
+	double mean = sum / times.size();
+	printf("%-9s mean %7.3f  median %7.3f  p95 %7.3f  p99 %7.3f  min %7.3f  max %7.3f ms\n",
+		label, mean, percentile(times, 50), percentile(times, 95), percentile(times, 99),
+		times.front(), times.back());
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point since) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// halves from the render size down to the output size, one box filtered
+// linear blit per level: the centre of each output pixel sits on the
+// corner of four source pixels
+static void downsample(OffscreenTarget const* targets, int levels, int width, int height) {
+	for (int level = 1; level < levels; level++) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, targets[level - 1].framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targets[level].framebuffer);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width / 2, height / 2, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		width /= 2;
+		height /= 2;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, targets[0].framebuffer);
+}
+
+int runHeadless(HeadlessOptions const& options) {
+	AudioSource audio;
+	if (!audio.Open(options.audioPath))
+		return -1;
+	long sampleRate = audio.SampleRate();
+	// 0 frames: the whole file, once
+	int frames = options.frames;
+	if (frames <= 0 && !audio.Synthetic())
+		frames = (int)ceil(audio.Length() * options.fps / sampleRate);
+	if (frames <= 0) {
+		fprintf(stderr, "The synthetic track never ends, give a frame count\n");
+		return -1;
+	}
+	// the scene is drawn at supersample times the output size, then halved down to it
+	int levels = 1;
+	while ((1 << (levels - 1)) < options.supersample && levels < MAX_SUPERSAMPLE_LEVELS)
+		levels++;
+	int width = options.width << (levels - 1);
+	int height = options.height << (levels - 1);
+
+	if (!createContext(options.width, options.height))
+		return -1;
+	glewExperimental = true;
+	if (glewInit() != GLEW_OK) {
+		fprintf(stderr, "Failed to initialize GLEW\n");
+		destroyContext();
+		return -1;
+	}
+	printf("Headless %dx%d, %d frames at %.1f fps on %s\n", options.width, options.height,
+		frames, options.fps, (const char*)glGetString(GL_RENDERER));
+	if (levels > 1)
+		printf("Supersampled from %dx%d\n", width, height);
+
+	int result = 0;
+	{
+		// render size first, output size last
+		OffscreenTarget targets[MAX_SUPERSAMPLE_LEVELS] = {};
+		for (int level = 0; level < levels; level++)
+			if (result == 0 && !createTarget(targets[level], width >> level, height >> level))
+				result = -1;
+		OffscreenTarget& target = targets[0];
+		Scene scene;
+		if (result == 0 && !scene.Init(options.barCount, options.historyRows, options.particleCount))
+			result = -1;
+		DynamicResolution resolution;
+		if (result == 0 && options.budgetMs > 0 &&
+			!resolution.Init(options.budgetMs, 0.5f, 1.0f, 0.3f, "shaders\\upscaleVtxShader.txt", "shaders\\upscaleFragShader.txt"))
+			result = -1;
+		PostProcess post;
+		bool postProcessing = options.bloomStrength > 0 || options.trailPersistence > 0;
+		if (result == 0 && postProcessing && !post.Init(options.bloomStrength, options.trailPersistence))
+			result = -1;
+		if (result == 0 && options.waveformMs > 0 &&
+			!scene.UseWaveform((int)(options.waveformMs * sampleRate / 1000.0), options.scopeTrigger))
+			result = -1;
+		GpuFft gpuFft;
+		if (result == 0 && options.gpuFft &&
+			(!gpuFft.Init(FFT_POINTS, "shaders\\fftVtxShader.txt", "shaders\\fftPassFragShader.txt", "shaders\\fftMagnitudeFragShader.txt") ||
+			!scene.UseSpectrumTexture(gpuFft.Spectrum(), FFT_POINTS / 2)))
+			result = -1;
+		FrameCapture capture;
+		if (result == 0 && options.recordPath != NULL &&
+			!capture.Open(options.recordPath, options.width, options.height, options.fps, "shaders\\postVtxShader.txt",
+			"shaders\\yuvFragShader.txt"))
+			result = -1;
+		std::vector<float> gpuIntensity;
+		double gpuFftError = 0;
+		int gpuFftChecks = 0;
+		FrameProfiler& profiler = frameProfiler();
+		if (result == 0 && options.profilePrefix != NULL && !profiler.Init())
+			fprintf(stderr, "Timer queries unavailable, not profiling\n");
+
+		// the same pipeline as the capture thread, fed a frame's worth of audio at a time;
+		// an export analyses ahead on its own thread while the frames are drawn
+		OfflineAnalysis analysis(audio, FFT_POINTS, options.fps);
+		if (options.offline)
+			analysis.Start(ANALYSIS_AHEAD);
+		// no thread: ticks are stepped up to each frame's time
+		static Simulation simulation;
+		static SimulationState state;
+		simulation.Reset(options.tickRate, initialCamera());
+		ControlInput noInput = {};
+
+		std::vector<double> analysisTimes, renderTimes;
+		analysisTimes.reserve(frames);
+		renderTimes.reserve(frames);
+		double firstFrameMs = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		TRACE_THREAD_NAME("headless");
+		for (int i = 0; result == 0 && i < frames; i++) {
+			TRACE_SCOPE("frame");
+			double seconds = i / options.fps;
+
+			profiler.BeginFrame();
+			OfflineAnalysis::Slot const* analysed;
+			{
+				ProfileScope scope(profiler, "analysis");
+				TRACE_SCOPE("analyse audio");
+				analysed = &analysis.Acquire(i);
+			}
+			scene.PushSamples(analysed->mid.data(), (int)analysed->mid.size());
+			scene.PushFrame(analysed->frame);
+			if (options.gpuFft) {
+				{
+					ProfileScope scope(profiler, "gpu fft");
+					gpuFft.CopyIn(analysed->mid.data(), (int)analysed->mid.size());
+					gpuFft.Transform();
+				}
+				// same samples as the CPU transform, so the spectra must agree
+				if (i % GPU_FFT_CHECK_INTERVAL == 0) {
+					gpuFft.ReadBack(gpuIntensity);
+					double peak = 0, error = 0;
+					for (int b = 0; b < FFT_POINTS / 2; b++) {
+						double expected = analysed->frame.spectrum[b];
+						peak = std::max(peak, expected);
+						error = std::max(error, fabs(gpuIntensity[b] - expected));
+					}
+					gpuFftError = std::max(gpuFftError, peak > 0 ? error / peak : error);
+					gpuFftChecks++;
+				}
+				// the transform leaves its own framebuffer and viewport bound
+				glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+				glViewport(0, 0, width, height);
+			}
+			// a frame no tick took is superseded by the next, as with a live source
+			AnalysisFrame const* fresh = &analysed->frame;
+			while (simulation.Ticks() < (uint64_t)ceil(seconds * options.tickRate)) {
+				simulation.Step(noInput, fresh);
+				fresh = NULL;
+			}
+			simulation.Interpolate(seconds - simulation.Delay(), state);
+			double analysisMs = analysed->ms;
+			analysis.Release();
+
+			std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+			float angle = ORBIT_RATE * (float)seconds;
+			glm::mat4 view = glm::lookAt(glm::vec3(5.0f * sin(angle), 1.0f, 5.0f * cos(angle)),
+				glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+			glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+				(float)width / (float)height, 0.1f, 100.0f);
+			int renderWidth = width, renderHeight = height;
+			GLuint sceneTarget = target.framebuffer;
+			if (postProcessing)
+				sceneTarget = post.Begin(width, height);
+			if (options.budgetMs > 0)
+				resolution.Begin(width, height, renderWidth, renderHeight);
+			scene.Render(projection, view, state.hasAudio ? &state.audio : NULL, state.time,
+				renderWidth, renderHeight);
+			if (options.budgetMs > 0) {
+				ProfileScope scope(profiler, "upscale");
+				resolution.End(sceneTarget);
+			}
+			if (postProcessing)
+				post.End(target.framebuffer);
+			if (options.budgetMs > 0)
+				resolution.Finish();
+			if (levels > 1) {
+				ProfileScope scope(profiler, "downsample");
+				downsample(targets, levels, width, height);
+			}
+			if (capture.IsOpen()) {
+				ProfileScope scope(profiler, "capture");
+				capture.Capture(targets[levels - 1].framebuffer);
+			}
+			// no swap to pace us: a benchmark waits for the GPU so the time covers the
+			// whole frame, an export leaves the GPU to run behind and the capture fences
+			if (!options.offline) {
+				ProfileScope scope(profiler, "finish");
+				glFinish();
+			}
+			profiler.EndFrame();
+
+			double renderMs = elapsedMs(renderStart);
+			if (i == 0) {
+				// first use compiles state and faults in resources, report it apart
+				firstFrameMs = renderMs;
+				continue;
+			}
+			analysisTimes.push_back(analysisMs);
+			renderTimes.push_back(renderMs);
+		}
+		// the writer's backlog counts towards the run
+		capture.Close();
+		analysis.Stop();
+		double totalMs = elapsedMs(start);
+
+		GLenum error = glGetError();
+		if (result == 0 && error != GL_NO_ERROR) {
+			fprintf(stderr, "GL error 0x%x during the run\n", error);
+			result = -1;
+		}
+		if (result == 0) {
+			printf("First frame %.3f ms\n", firstFrameMs);
+			printStatistics("Analysis", analysisTimes);
+			printStatistics("Render", renderTimes);
+			printf("%d frames in %.1f ms, %.1f fps\n", frames, totalMs,
+				totalMs > 0 ? frames * 1000.0 / totalMs : 0.0);
+			if (options.offline)
+				printf("Analysis ahead: %d frames, renderer waited %u times\n", ANALYSIS_AHEAD, analysis.Waits());
+			printf("State cache: %llu GL calls issued, %llu elided\n",
+				(unsigned long long)glState().Issued(), (unsigned long long)glState().Elided());
+			if (options.budgetMs > 0)
+				printf("Dynamic resolution: scale %.2f, GPU %.2f ms of %.1f, %u changes\n",
+					resolution.Scale(), resolution.GpuMs(), options.budgetMs, resolution.Changes());
+			if (options.gpuFft) {
+				printf("GPU FFT: %d points in %d passes, worst error %.2e of the peak over %d checks\n",
+					gpuFft.Points(), gpuFft.Passes(), gpuFftError, gpuFftChecks);
+				if (gpuFftError > GPU_FFT_TOLERANCE) {
+					fprintf(stderr, "GPU FFT does not match Fft::Transform\n");
+					result = -1;
+				}
+			}
+			if (options.recordPath != NULL)
+				printf("Recording: %llu frames, %u stalls\n", (unsigned long long)capture.Frames(), capture.Stalls());
+			if (options.waveformMs > 0) {
+				Waveform const& trace = scene.Trace();
+				printf("Waveform: %d sample pyramid, drawn from level %d, %llu entries uploaded",
+					trace.Capacity(), trace.Level(), (unsigned long long)trace.Uploaded());
+				if (options.scopeTrigger)
+					printf(", triggered %u of %u frames", trace.Triggers(), trace.TriggeredDraws());
+				printf("\n");
+			}
+			if (postProcessing)
+				printf("Post process: %d pooled targets, %u created\n", post.Pool().Allocated(), post.Pool().Created());
+			if (profiler.Enabled()) {
+				profiler.PrintSummary();
+				profiler.WriteCsv(options.profilePrefix);
+			}
+		}
+
+		// scene and targets go before the context does
+		for (int level = 0; level < levels; level++)
+			destroyTarget(targets[level]);
+	}
+	destroyContext();
+	return result;
+}
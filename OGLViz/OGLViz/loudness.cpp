@@ -0,0 +1,288 @@
+#include <math.h>
+#include <string.h>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LOUDNESS_SSE
+#endif
+
+#include "headers\\loudness.hpp"
+#include "headers\\trace.hpp"
+
+static const double PI_D = 3.14159265358979323846;
+static const float SILENCE_DB = -120.0f;
+static const float ABSOLUTE_GATE = -70.0f;
+static const float RELATIVE_GATE = -10.0f;
+
+static float toDb(double meanSquare) {
+	return meanSquare > 1e-12 ? (float)(10.0 * log10(meanSquare)) : SILENCE_DB;
+}
+
+// BS.1770: sum of channel mean squares (L and R weigh 1.0)
+static float toLufs(double energy) {
+	return energy > 1e-12 ? (float)(-0.691 + 10.0 * log10(energy)) : SILENCE_DB;
+}
+
+LoudnessMeter::LoudnessMeter(int sampleRate)
+	: _subBlockSamples(sampleRate / 10)
+{
+	// K-weighting, BS.1770 filters re-derived for the actual sample rate
+	// stage 1: high shelf, +4 dB above ~1.5 kHz
+	double f0 = 1681.974450955533, G = 3.999843853973347, Q = 0.7071752369554196;
+	double K = tan(PI_D * f0 / sampleRate);
+	double Vh = pow(10.0, G / 20.0);
+	double Vb = pow(Vh, 0.4996667741545416);
+	double a0 = 1.0 + K / Q + K * K;
+	float s1[5] = {
+		(float)((Vh + Vb * K / Q + K * K) / a0),
+		(float)(2.0 * (K * K - Vh) / a0),
+		(float)((Vh - Vb * K / Q + K * K) / a0),
+		(float)(2.0 * (K * K - 1.0) / a0),
+		(float)((1.0 - K / Q + K * K) / a0) };
+	// stage 2: RLB high-pass at ~38 Hz; the numerator stays {1, -2, 1} as in
+	// BS.1770's table, only the denominator is normalised by a0
+	f0 = 38.13547087602444;
+	Q = 0.5003270373238773;
+	K = tan(PI_D * f0 / sampleRate);
+	a0 = 1.0 + K / Q + K * K;
+	float s2[5] = {
+		1.0f, -2.0f, 1.0f,
+		(float)(2.0 * (K * K - 1.0) / a0),
+		(float)((1.0 - K / Q + K * K) / a0) };
+	for (int lane = 0; lane < 4; lane++) {
+		float const* s = lane < 2 ? s1 : s2;
+		_b0[lane] = s[0];
+		_b1[lane] = s[1];
+		_b2[lane] = s[2];
+		_a1[lane] = s[3];
+		_a2[lane] = s[4];
+		_z1[lane] = _z2[lane] = _y[lane] = 0.0f;
+	}
+
+	// 48 tap windowed-sinc interpolator split into 4 phases of 12,
+	// each phase normalised to unity gain at DC
+	const int N = PHASES * TAPS;
+	for (int p = 0; p < PHASES; p++) {
+		double sum = 0.0;
+		double h[TAPS];
+		for (int j = 0; j < TAPS; j++) {
+			int k = PHASES * j + p;
+			double t = (k - N / 2) / (double)PHASES;
+			double sinc = t == 0.0 ? 1.0 : sin(PI_D * t) / (PI_D * t);
+			double window = 0.42 - 0.5 * cos(2.0 * PI_D * (k + 0.5) / N) + 0.08 * cos(4.0 * PI_D * (k + 0.5) / N);
+			h[j] = sinc * window;
+			sum += h[j];
+		}
+		// oldest sample first, so a block dot product lines up with memory
+		for (int j = 0; j < TAPS; j++)
+			_taps[p][TAPS - 1 - j] = (float)(h[j] / sum);
+	}
+	memset(_historyL, 0, sizeof _historyL);
+	memset(_historyR, 0, sizeof _historyR);
+
+	_subBlockFill = 0;
+	_weighted = 0.0;
+	_raw = 0.0;
+	_cSub = 0;
+	memset(_subEnergy, 0, sizeof _subEnergy);
+	memset(_subRaw, 0, sizeof _subRaw);
+	ResetIntegrated();
+}
+
+void LoudnessMeter::ResetIntegrated()
+{
+	memset(_histCount, 0, sizeof _histCount);
+	memset(_histEnergy, 0, sizeof _histEnergy);
+}
+
+// K-weight count samples of both channels into the open sub-block
+void LoudnessMeter::Filter(const float* left, const float* right, int count)
+{
+	double weighted = 0.0, raw = 0.0;
+#ifdef LOUDNESS_SSE
+	__m128 b0 = _mm_loadu_ps(_b0), b1 = _mm_loadu_ps(_b1), b2 = _mm_loadu_ps(_b2);
+	__m128 a1 = _mm_loadu_ps(_a1), a2 = _mm_loadu_ps(_a2);
+	__m128 z1 = _mm_loadu_ps(_z1), z2 = _mm_loadu_ps(_z2);
+	__m128 y = _mm_loadu_ps(_y);
+	__m128 energy = _mm_setzero_ps();
+	__m128 rawEnergy = _mm_setzero_ps();
+	for (int i = 0; i < count; i++) {
+		// [L, R, stage 1 L of i-1, stage 1 R of i-1]
+		__m128 in = _mm_unpacklo_ps(_mm_load_ss(left + i), _mm_load_ss(right + i));
+		__m128 x = _mm_movelh_ps(in, y);
+		y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+		z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+		z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+		energy = _mm_add_ps(energy, _mm_mul_ps(y, y));
+		rawEnergy = _mm_add_ps(rawEnergy, _mm_mul_ps(in, in));
+	}
+	_mm_storeu_ps(_z1, z1);
+	_mm_storeu_ps(_z2, z2);
+	_mm_storeu_ps(_y, y);
+	float e[4], r[4];
+	_mm_storeu_ps(e, energy);
+	_mm_storeu_ps(r, rawEnergy);
+	weighted = (double)e[2] + e[3];
+	raw = (double)r[0] + r[1];
+#else
+	for (int i = 0; i < count; i++) {
+		float x[4] = { left[i], right[i], _y[0], _y[1] };
+		for (int lane = 0; lane < 4; lane++) {
+			float out = _b0[lane] * x[lane] + _z1[lane];
+			_z1[lane] = _b1[lane] * x[lane] - _a1[lane] * out + _z2[lane];
+			_z2[lane] = _b2[lane] * x[lane] - _a2[lane] * out;
+			_y[lane] = out;
+		}
+		weighted += (double)_y[2] * _y[2] + (double)_y[3] * _y[3];
+		raw += (double)left[i] * left[i] + (double)right[i] * right[i];
+	}
+#endif
+	_weighted += weighted;
+	_raw += raw;
+}
+
+// Peak of the 4x interpolated signal over count new samples
+float LoudnessMeter::TruePeak(const float* x, float* history, int count)
+{
+	_scratch.resize(TAPS - 1 + count);
+	float* buf = &_scratch[0];
+	memcpy(buf, history, (TAPS - 1) * sizeof(float));
+	memcpy(buf + TAPS - 1, x, count * sizeof(float));
+
+	float peak = 0.0f;
+#ifdef LOUDNESS_SSE
+	__m128 t[PHASES][TAPS / 4];
+	for (int p = 0; p < PHASES; p++)
+		for (int k = 0; k < TAPS / 4; k++)
+			t[p][k] = _mm_loadu_ps(&_taps[p][4 * k]);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 vpeak = _mm_setzero_ps();
+	for (int n = 0; n < count; n++) {
+		const float* w = buf + n;
+		__m128 x0 = _mm_loadu_ps(w), x1 = _mm_loadu_ps(w + 4), x2 = _mm_loadu_ps(w + 8);
+		__m128 s[PHASES];
+		for (int p = 0; p < PHASES; p++)
+			s[p] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, t[p][0]), _mm_mul_ps(x1, t[p][1])), _mm_mul_ps(x2, t[p][2]));
+		// horizontal sums of the four phases at once
+		_MM_TRANSPOSE4_PS(s[0], s[1], s[2], s[3]);
+		__m128 out = _mm_add_ps(_mm_add_ps(s[0], s[1]), _mm_add_ps(s[2], s[3]));
+		vpeak = _mm_max_ps(vpeak, _mm_and_ps(out, absMask));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, vpeak);
+	for (int k = 0; k < 4; k++)
+		if (lanes[k] > peak)
+			peak = lanes[k];
+#else
+	for (int n = 0; n < count; n++) {
+		for (int p = 0; p < PHASES; p++) {
+			float out = 0.0f;
+			for (int j = 0; j < TAPS; j++)
+				out += buf[n + j] * _taps[p][j];
+			if (fabsf(out) > peak)
+				peak = fabsf(out);
+		}
+	}
+#endif
+	memcpy(history, buf + count, (TAPS - 1) * sizeof(float));
+	return peak;
+}
+
+void LoudnessMeter::EndSubBlock()
+{
+	int slot = _cSub % SUB_BLOCKS;
+	_subEnergy[slot] = (float)(_weighted / _subBlockSamples);
+	_subRaw[slot] = (float)(_raw / _subBlockSamples);
+	_cSub++;
+	_weighted = 0.0;
+	_raw = 0.0;
+	_subBlockFill = 0;
+
+	// every 100 ms a new 400 ms gating block is complete
+	if (_cSub < 4)
+		return;
+	double energy = 0.0;
+	for (int k = 1; k <= 4; k++)
+		energy += _subEnergy[(_cSub - k) % SUB_BLOCKS];
+	energy /= 4.0;
+	float lufs = toLufs(energy);
+	if (lufs < ABSOLUTE_GATE)
+		return;
+	int bin = (int)((lufs - ABSOLUTE_GATE) * 10.0f);
+	if (bin >= HISTOGRAM)
+		bin = HISTOGRAM - 1;
+	_histCount[bin]++;
+	_histEnergy[bin] += energy;
+}
+
+float LoudnessMeter::Integrated() const
+{
+	unsigned count = 0;
+	double energy = 0.0;
+	for (int i = 0; i < HISTOGRAM; i++) {
+		count += _histCount[i];
+		energy += _histEnergy[i];
+	}
+	if (count == 0)
+		return SILENCE_DB;
+	float gate = toLufs(energy / count) + RELATIVE_GATE;
+	int first = (int)((gate - ABSOLUTE_GATE) * 10.0f);
+	if (first < 0)
+		first = 0;
+	count = 0;
+	energy = 0.0;
+	for (int i = first; i < HISTOGRAM; i++) {
+		count += _histCount[i];
+		energy += _histEnergy[i];
+	}
+	return count > 0 ? toLufs(energy / count) : SILENCE_DB;
+}
+
+void LoudnessMeter::Process(const float* left, const float* right, int count, AnalysisFrame& frame)
+{
+	TRACE_SCOPE("LoudnessMeter::Process");
+	// sample peak over the raw block
+	float peak = 0.0f;
+	for (int i = 0; i < count; i++) {
+		float l = fabsf(left[i]), r = fabsf(right[i]);
+		if (l > peak)
+			peak = l;
+		if (r > peak)
+			peak = r;
+	}
+
+	for (int done = 0; done < count; ) {
+		int n = _subBlockSamples - _subBlockFill;
+		if (n > count - done)
+			n = count - done;
+		Filter(left + done, right + done, n);
+		_subBlockFill += n;
+		done += n;
+		if (_subBlockFill == _subBlockSamples)
+			EndSubBlock();
+	}
+
+	float truePeak = TruePeak(left, _historyL, count);
+	float truePeakR = TruePeak(right, _historyR, count);
+	if (truePeakR > truePeak)
+		truePeak = truePeakR;
+
+	double momentary = 0.0, shortTerm = 0.0, raw = 0.0;
+	int nMomentary = _cSub < 4 ? _cSub : 4;
+	int nShort = _cSub < SUB_BLOCKS ? _cSub : SUB_BLOCKS;
+	for (int k = 1; k <= nShort; k++) {
+		int slot = (_cSub - k) % SUB_BLOCKS;
+		shortTerm += _subEnergy[slot];
+		if (k <= nMomentary) {
+			momentary += _subEnergy[slot];
+			raw += _subRaw[slot];
+		}
+	}
+
+	frame.peakDb = peak > 0.0f ? 20.0f * log10f(peak) : SILENCE_DB;
+	frame.truePeakDb = truePeak > 0.0f ? 20.0f * log10f(truePeak) : SILENCE_DB;
+	// per channel RMS, averaged over L and R
+	frame.rmsDb = nMomentary > 0 ? toDb(raw / (2.0 * nMomentary)) : SILENCE_DB;
+	frame.momentaryLufs = nMomentary > 0 ? toLufs(momentary / nMomentary) : SILENCE_DB;
+	frame.shortTermLufs = nShort > 0 ? toLufs(shortTerm / nShort) : SILENCE_DB;
+	frame.integratedLufs = Integrated();
+}
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <vector>
 #include <algorithm>
+#include <chrono>
 
 #include "GL\\glew.h"
 #include "GL\\glut.h"
@@ -20,6 +21,20 @@
 #include "headers\\control.hpp"
 #include "headers\\objloader.hpp"
 #include "headers\\vboindexer.hpp"
+#include "headers\\spectrumbus.hpp"
+#include "headers\\netstream.hpp"
+#include "headers\\analysis.hpp"
+#include "headers\\uploadbench.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\shadermanager.hpp"
+#include "headers\\scene.hpp"
+#include "headers\\headless.hpp"
+#include "headers\\profiler.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\simulation.hpp"
+#include "headers\\dynamicresolution.hpp"
+#include "headers\\postprocess.hpp"
+#include "headers\\framecapture.hpp"
 
 //makes using GL Math (GLM) for vectors easier so a bunch of functions don't need glm:: prepended
 using namespace glm;
@@ -77,166 +92,391 @@ int getInput() {
 	return 1;
 }
 
-int setupFlags() {
-	// Enable depth test
-	glEnable(GL_DEPTH_TEST);
-	// Accept fragment if it closer to the camera than the former one
-	glDepthFunc(GL_LESS);
-	// Cull triangles which normal is not towards the camera
-	glEnable(GL_CULL_FACE);
-	// Dark blue background
-	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
-	return 1;
-}
-
-
-const char* vertexShaderLocation = "shaders\\vtxShader.txt";
-const char* fragmentShaderLocation = "shaders\\fragShader.txt";
-const char* uvLocation = "resources\\uvmap.DDS";
+// render nodes hold network frames this long so they all show the same one
+const int NET_PLAYOUT_DELAY_MS = 40;
+const char* upscaleVertexShaderLocation = "shaders\\upscaleVtxShader.txt";
+const char* upscaleFragmentShaderLocation = "shaders\\upscaleFragShader.txt";
 
 int main(int argc, char* argv[]) {
 	fprintf(stdout, "Visualizer Project by LiquidState, C++ build utilizing OpenGL\nShoutout to opengl-tutorial.org\n");
-	
+
+	// --publish <bus> / --multicast <addr:port> : analysis only, no window
+	// --subscribe <bus> : render from another process' analysis
+	// --receive <addr:port> : render from a remote analysis node
+	// --history <rows> : spectrogram length in analysis frames, 0 hides it
+	// --shader-cache <dir> : program binary cache, "none" to always compile
+	// --upload-bench : compare buffer upload paths on this GPU and exit
+	// --headless <W>x<H> : no window, render offscreen and print frame times
+	//   --frames <n> / --fps <rate> : run length and audio advance per frame; --fps is also
+	//   the rate --record stamps on its output, the monitor's refresh rate otherwise
+	//   --audio <file.wav> : 16-bit PCM input, synthetic audio without it
+	//   --gpu-fft : transform on the GPU for the bars, validated against the CPU one; headless and
+	//   --render only, a window gets spectra from the bus or multicast and never the samples
+	// --render <file> : export --audio offline as fast as the machine allows, to a file
+	//   like --record's; size from --headless, the whole file unless --frames is given
+	//   --supersample <1|2|4> : render size over output size, 2 by default
+	//   --scope <ms> : oscilloscope of the last ms of audio, --trigger holds it on zero crossings
+	// --profile <prefix> : time frame scopes, write <prefix>_trace.csv and
+	//   <prefix>_summary.csv on exit and whenever F9 is pressed
+	// --trace <file.json> : record a Chrome trace of this process, written on exit
+	// --tick <hz> : simulation rate, independent of the render rate
+	// --budget <ms> : GPU frame time to hold by lowering the render resolution, 0 renders at full size
+	//   --min-scale <0..1> : lowest resolution scale, --sharpen <0..1> : upscale sharpening
+	// --bloom <strength> : audio reactive glow, 0 turns it off
+	// --trails <0..1> : fraction of a trail left after a second, 0 turns them off
+	// --particles <n> : GPU particle count, 65536 by default, 0 turns them off
+	// --record <file> : capture every frame, .y4m or raw RGB24, "|<command>" pipes Y4M to a command
+	const char* busName = NULL;
+	const char* publishName = NULL;
+	const char* multicastGroup = NULL;
+	const char* receiveGroup = NULL;
+	int barCount = 512;
+	int historyRows = 256;
+	const char* shaderCache = "shadercache";
+	bool uploadBench = false;
+	const char* profilePrefix = NULL;
+	const char* tracePath = NULL;
+	double tickRate = Simulation::DEFAULT_RATE;
+	double frameBudgetMs = 16.6;
+	float minScale = 0.5f;
+	float sharpen = 0.3f;
+	bool budgetGiven = false;
+	float bloomStrength = 0.6f;
+	float trailPersistence = 0.05f;
+	bool bloomGiven = false;
+	bool trailsGiven = false;
+	// sized for integrated GPUs; a discrete one takes millions
+	int particleCount = 1 << 16;
+	bool particlesGiven = false;
+	const char* recordPath = NULL;
+	const char* renderPath = NULL;
+	int supersample = 2;
+	bool framesGiven = false;
+	bool fpsGiven = false;
+	bool headless = false;
+	HeadlessOptions headlessOptions;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--publish") == 0 && i + 1 < argc)
+			publishName = argv[++i];
+		else if (strcmp(argv[i], "--multicast") == 0 && i + 1 < argc)
+			multicastGroup = argv[++i];
+		else if (strcmp(argv[i], "--subscribe") == 0 && i + 1 < argc)
+			busName = argv[++i];
+		else if (strcmp(argv[i], "--receive") == 0 && i + 1 < argc)
+			receiveGroup = argv[++i];
+		else if (strcmp(argv[i], "--bars") == 0 && i + 1 < argc)
+			barCount = std::min(std::max(atoi(argv[++i]), 1), (int)Scene::MAX_BARS);
+		else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc)
+			historyRows = std::min(std::max(atoi(argv[++i]), 0), 4096);
+		else if (strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc)
+			shaderCache = argv[++i];
+		else if (strcmp(argv[i], "--upload-bench") == 0)
+			uploadBench = true;
+		else if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+			headless = true;
+			if (sscanf_s(argv[++i], "%dx%d", &headlessOptions.width, &headlessOptions.height) != 2 ||
+				headlessOptions.width <= 0 || headlessOptions.height <= 0) {
+				fprintf(stderr, "Main expects --headless <width>x<height>\n");
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			headlessOptions.frames = std::max(atoi(argv[++i]), 1);
+			framesGiven = true;
+		}
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+			headlessOptions.fps = std::max(atof(argv[++i]), 1.0);
+			fpsGiven = true;
+		}
+		else if (strcmp(argv[i], "--audio") == 0 && i + 1 < argc)
+			headlessOptions.audioPath = argv[++i];
+		else if (strcmp(argv[i], "--gpu-fft") == 0)
+			headlessOptions.gpuFft = true;
+		else if (strcmp(argv[i], "--scope") == 0 && i + 1 < argc)
+			headlessOptions.waveformMs = std::min(std::max(atof(argv[++i]), 0.0), 60000.0);
+		else if (strcmp(argv[i], "--trigger") == 0)
+			headlessOptions.scopeTrigger = true;
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+			profilePrefix = argv[++i];
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			tracePath = argv[++i];
+		else if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc)
+			tickRate = std::min(std::max(atof(argv[++i]), 10.0), 2000.0);
+		else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+			frameBudgetMs = std::max(atof(argv[++i]), 0.0);
+			budgetGiven = true;
+		}
+		else if (strcmp(argv[i], "--min-scale") == 0 && i + 1 < argc)
+			minScale = std::min(std::max((float)atof(argv[++i]), 0.25f), 1.0f);
+		else if (strcmp(argv[i], "--sharpen") == 0 && i + 1 < argc)
+			sharpen = std::min(std::max((float)atof(argv[++i]), 0.0f), 1.0f);
+		else if (strcmp(argv[i], "--bloom") == 0 && i + 1 < argc) {
+			bloomStrength = std::min(std::max((float)atof(argv[++i]), 0.0f), 4.0f);
+			bloomGiven = true;
+		}
+		else if (strcmp(argv[i], "--trails") == 0 && i + 1 < argc) {
+			trailPersistence = std::min(std::max((float)atof(argv[++i]), 0.0f), 0.99f);
+			trailsGiven = true;
+		}
+		else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc) {
+			particleCount = std::min(std::max(atoi(argv[++i]), 0), (int)ParticleSystem::MAX_PARTICLES);
+			particlesGiven = true;
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			recordPath = argv[++i];
+		else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc)
+			renderPath = argv[++i];
+		else if (strcmp(argv[i], "--supersample") == 0 && i + 1 < argc)
+			supersample = std::min(std::max(atoi(argv[++i]), 1), 4);
+	}
+	if (tracePath != NULL && !traceStart())
+		tracePath = NULL;
+	if (publishName != NULL || multicastGroup != NULL) {
+		int result = runAnalysisPublisher(publishName, multicastGroup);
+		if (tracePath != NULL)
+			traceWrite(tracePath);
+		return result;
+	}
+
+	// Programs linked on an earlier run load from the binary cache
+	if (strcmp(shaderCache, "none") != 0) {
+		CreateDirectoryA(shaderCache, NULL);
+		setShaderCacheDirectory(shaderCache);
+	}
+
+	// an export is a headless run that records and paces itself
+	if (renderPath != NULL) {
+		headless = true;
+		recordPath = renderPath;
+		headlessOptions.supersample = supersample;
+		headlessOptions.offline = true;
+		if (!framesGiven)
+			headlessOptions.frames = 0;
+	}
+	if (headless) {
+		headlessOptions.barCount = barCount;
+		headlessOptions.historyRows = historyRows;
+		headlessOptions.profilePrefix = profilePrefix;
+		headlessOptions.tickRate = tickRate;
+		// benchmarks run at a fixed size unless a budget is asked for
+		headlessOptions.budgetMs = budgetGiven ? frameBudgetMs : 0.0;
+		// each effect only when asked for by its own option
+		headlessOptions.bloomStrength = bloomGiven ? bloomStrength : 0.0f;
+		headlessOptions.trailPersistence = trailsGiven ? trailPersistence : 0.0f;
+		headlessOptions.particleCount = particlesGiven ? particleCount : 0;
+		headlessOptions.recordPath = recordPath;
+		int result = runHeadless(headlessOptions);
+		if (tracePath != NULL)
+			traceWrite(tracePath);
+		return result;
+	}
+
+	if (headlessOptions.gpuFft)
+		fprintf(stderr, "Main ignores --gpu-fft without --headless or --render, a window has no samples to transform\n");
+
+	SpectrumBusReader bus;
+	if (busName != NULL && !bus.Attach(busName)) {
+		fprintf(stderr, "Main could not attach to spectrum bus %s\n", busName);
+		return -1;
+	}
+	// its jitter buffer holds a dozen frames, too much for the stack
+	static SpectrumReceiver receiver;
+	if (receiveGroup != NULL && !receiver.Open(receiveGroup, NET_PLAYOUT_DELAY_MS)) {
+		fprintf(stderr, "Main could not join multicast group %s\n", receiveGroup);
+		return -1;
+	}
 	if (!initWindow()) {
-		fprintf(stdout, "Main window initialization failed\n");
+		fprintf(stderr, "Main window initialization failed\n");
 		return -1;
 	}
 	
 	if (!initGlew()) {
-		fprintf(stdout, "Main glew initialization failed \n");
+		fprintf(stderr, "Main glew initialization failed \n");
 		return -1;
 	}
+	if (uploadBench) {
+		int result = runUploadBenchmark(600);
+		glfwTerminate();
+		return result;
+	}
 
 	if (!getInput()) {
-		fprintf(stdout, "Main input handler initialization failed\n");
-		return -1;
-	}
-	if (!setupFlags()) {
-		fprintf(stdout, "Main setupFlags initialization failed\n");
+		fprintf(stderr, "Main input handler initialization failed\n");
 		return -1;
 	}
 
-	GLuint VertexArrayID;
-	glGenVertexArrays(1, &VertexArrayID);
-	glBindVertexArray(VertexArrayID);
-
-	// Create and compile our GLSL program from the shaders
-	GLuint programID = LoadShaders(vertexShaderLocation, fragmentShaderLocation);
-
-	// Get a handle for our "MVP" uniform
-	GLuint MatrixID = glGetUniformLocation(programID, "MVP");
-	GLuint ViewMatrixID = glGetUniformLocation(programID, "V");
-	GLuint ModelMatrixID = glGetUniformLocation(programID, "M");
-
-	// Load the texture
-	GLuint Texture = loadDDS(uvLocation);
-
-	// Get a handle for our "myTextureSampler" uniform
-	GLuint TextureID = glGetUniformLocation(programID, "myTextureSampler");
-
-	// Read our .obj file
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec2> uvs;
-	std::vector<glm::vec3> normals; // Won't be used at the moment.
-	bool res = loadOBJ("resources\\suzanne.obj", vertices, uvs, normals);
-
-	// Load it into a VBO
-
-	GLuint vertexbuffer;
-	glGenBuffers(1, &vertexbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-
-	GLuint uvbuffer;
-	glGenBuffers(1, &uvbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-	glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-
-	GLuint normalbuffer;
-	glGenBuffers(1, &normalbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
-
-	// Get a handle for our "LightPosition" uniform
-	glUseProgram(programID);
-	GLuint LightID = glGetUniformLocation(programID, "LightPosition_worldspace");
-
-	//LOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOP ============================================================================
-	do {
-		// Clear the screen.
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		//tell gl which shaders to use, compiled on load, can be added to / edited on the fly
-		glUseProgram(programID);
-		// Compute the MVP matrix from keyboard and mouse input
-		computeMatricesFromInputs();
-		mat4 ProjectionMatrix = getProjectionMatrix();
-		mat4 ViewMatrix = getViewMatrix();
-		mat4 ModelMatrix = mat4(1.0f);
-		mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
-
-		// Send our transformation to the currently bound shader, 
-		// in the "MVP" uniform
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrix[0][0]);
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrix[0][0]);
-
-		glm::vec3 lightPos = glm::vec3(4, 4, 4);
-		glUniform3f(LightID, lightPos.x, lightPos.y, lightPos.z);
-
-		// Bind our texture in Texture Unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, Texture);
-		// Set our "myTextureSampler" sampler to use Texture Unit 0
-		glUniform1i(TextureID, 0);
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-		glVertexAttribPointer(
-			2,                  // attribute. No particular reason for 0, but must match the layout in the shader.
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-		glVertexAttribPointer(
-			1,                                // attribute. No particular reason for 1, but must match the layout in the shader.
-			2,                                // size : U+V => 2
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// DRAW
-		glDrawArrays(GL_TRIANGLES, 0, 12 * 3); // 12*3 indices starting at 0 -> 12 triangles
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-
-		// Swap buffers
-		glfwSwapBuffers(window);
-		glfwPollEvents();
-	} // Check if the ESC key was pressed or the window was closed
-	while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
-		glfwWindowShouldClose(window) == 0);
-
-	// Cleanup VBO and shader
-	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteBuffers(1, &uvbuffer);
-	glDeleteProgram(programID);
-	glDeleteTextures(1, &TextureID);
-	glDeleteVertexArrays(1, &VertexArrayID);
+	// GL objects are released at the end of this block, while the context is still alive
+	{
+		// Mesh, particles, bars and spectrogram with their programs, textures and uniform blocks
+		Scene scene;
+		if (!scene.Init(barCount, historyRows, particleCount)) {
+			fprintf(stderr, "Main scene initialization failed\n");
+			return -1;
+		}
+
+		// Saving a shader file rebuilds its program in the background and swaps it in once it links
+		ShaderManager shaders;
+		shaders.Init(window);
+		scene.Watch(shaders);
+
+		// Scene drawn at a scale that holds the frame budget, then upscaled to the window
+		DynamicResolution resolution;
+		bool dynamicResolution = frameBudgetMs > 0;
+		if (dynamicResolution) {
+			if (!resolution.Init(frameBudgetMs, minScale, 1.0f, sharpen, upscaleVertexShaderLocation, upscaleFragmentShaderLocation)) {
+				fprintf(stderr, "Main dynamic resolution initialization failed\n");
+				return -1;
+			}
+			shaders.Watch(upscaleVertexShaderLocation, upscaleFragmentShaderLocation, [&](GLuint program) {
+				resolution.SetProgram(program);
+			});
+		}
+
+		// Bloom and trails over the scene, from a pool of reduced size targets
+		PostProcess post;
+		bool postProcessing = bloomStrength > 0 || trailPersistence > 0;
+		if (postProcessing) {
+			if (!post.Init(bloomStrength, trailPersistence)) {
+				fprintf(stderr, "Main post process initialization failed\n");
+				return -1;
+			}
+			post.Watch(shaders);
+		}
+
+		// Frames read back a few frames late and written on another thread
+		FrameCapture capture;
+		if (recordPath != NULL) {
+			int recordWidth, recordHeight;
+			glfwGetFramebufferSize(window, &recordWidth, &recordHeight);
+			// swaps wait for vblank, so frames come at the monitor's refresh rate unless told otherwise
+			glfwSwapInterval(1);
+			double recordFps = headlessOptions.fps;
+			const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+			if (!fpsGiven && mode != NULL && mode->refreshRate > 0)
+				recordFps = mode->refreshRate;
+			if (!capture.Open(recordPath, recordWidth, recordHeight, recordFps, "shaders\\postVtxShader.txt",
+				"shaders\\yuvFragShader.txt")) {
+				fprintf(stderr, "Main could not record to %s\n", recordPath);
+				return -1;
+			}
+		}
+
+		FrameProfiler& profiler = frameProfiler();
+		if (profilePrefix != NULL && !profiler.Init())
+			fprintf(stderr, "Main profiler initialization failed, timer queries unavailable\n");
+		bool profileKeyDown = false;
+
+		// Analysis consumption, camera and audio smoothing tick at a fixed rate on their
+		// own thread; the bus and the receiver belong to it until Stop.
+		// Static like the frames below, it holds a dozen of them
+		static Simulation simulation;
+		simulation.Reset(tickRate, initialCamera());
+		simulation.Start(busName != NULL ? &bus : NULL, receiveGroup != NULL ? &receiver : NULL);
+		static SimulationState state;
+		static AnalysisFrame received;
+
+		TRACE_THREAD_NAME("render");
+		//LOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOP ============================================================================
+		do {
+			TRACE_SCOPE("frame");
+			profiler.BeginFrame();
+
+			// swap in any shader that finished rebuilding
+			{
+				ProfileScope scope(profiler, "shaders");
+				shaders.Update();
+			}
+
+			// keyboard and mouse go to the next tick, the frame shows a blend of the two newest
+			int inputScope = profiler.Begin("input");
+			simulation.PushInput(readControlInput());
+			simulation.Interpolate(simulation.Now() - simulation.Delay(), state);
+			// the waterfall shows every frame as analysed, not the smoothed blend
+			while (simulation.TakeReceived(received))
+				scene.PushFrame(received);
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+			float aspect = height > 0 ? (float)width / (float)height : 4.0f / 3.0f;
+			profiler.End(inputScope);
+
+			// DRAW
+			int renderWidth = width, renderHeight = height;
+			GLuint sceneTarget = 0;
+			if (postProcessing)
+				sceneTarget = post.Begin(width, height);
+			if (dynamicResolution)
+				resolution.Begin(width, height, renderWidth, renderHeight);
+			scene.Render(cameraProjection(state.camera, aspect), cameraView(state.camera),
+				state.hasAudio ? &state.audio : NULL, state.time, renderWidth, renderHeight);
+			if (dynamicResolution) {
+				ProfileScope scope(profiler, "upscale");
+				resolution.End(sceneTarget);
+			}
+			// times each of its passes
+			if (postProcessing)
+				post.End();
+			// the budget covers the whole frame, post processing included
+			if (dynamicResolution)
+				resolution.Finish();
+			// the file keeps the size it was opened at
+			if (capture.IsOpen() && width == capture.Width() && height == capture.Height()) {
+				ProfileScope scope(profiler, "capture");
+				capture.Capture(0);
+			}
+
+			// Swap buffers
+			{
+				ProfileScope scope(profiler, "swap");
+				TRACE_SCOPE("glfwSwapBuffers");
+				glfwSwapBuffers(window);
+				glfwPollEvents();
+			}
+			profiler.EndFrame();
+
+			// F9 writes the profile so far
+			bool profileKey = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+			if (profileKey && !profileKeyDown && profiler.Enabled())
+				profiler.WriteCsv(profilePrefix);
+			profileKeyDown = profileKey;
+		} // Check if the ESC key was pressed or the window was closed
+		while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
+			glfwWindowShouldClose(window) == 0);
+		simulation.Stop();
+		if (capture.IsOpen()) {
+			capture.Close();
+			fprintf(stdout, "Recording: %llu frames, %u stalls\n", (unsigned long long)capture.Frames(), capture.Stalls());
+		}
+
+		if (dynamicResolution)
+			fprintf(stdout, "Dynamic resolution: scale %.2f, GPU %.2f ms of %.1f, %u changes\n",
+				resolution.Scale(), resolution.GpuMs(), frameBudgetMs, resolution.Changes());
+		if (postProcessing)
+			fprintf(stdout, "Post process: %d pooled targets, %u created\n",
+				post.Pool().Allocated(), post.Pool().Created());
+		fprintf(stdout, "Simulation: %llu ticks at %.0f Hz, %llu skipped\n",
+			(unsigned long long)simulation.Ticks(), simulation.Rate(), (unsigned long long)simulation.Skipped());
+		if (busName != NULL)
+			fprintf(stdout, "Spectrum bus: %llu frames dropped\n", (unsigned long long)bus.Dropped());
+		if (receiveGroup != NULL)
+			fprintf(stdout, "Multicast: %llu datagrams, %llu frames concealed, %llu late\n",
+				(unsigned long long)receiver.Received(), (unsigned long long)receiver.Concealed(),
+				(unsigned long long)receiver.Late());
+		fprintf(stdout, "Bar uploads: %s, %u skipped, %u orphans\n",
+			scene.Bars().Stream().Persistent() ? "persistent" : "unsynchronized",
+			scene.Bars().Stream().Skips(), scene.Bars().Stream().Orphans());
+		fprintf(stdout, "Shader reloads: %u, %u failed\n", shaders.Reloads(), shaders.Failures());
+		fprintf(stdout, "State cache: %llu GL calls issued, %llu elided\n",
+			(unsigned long long)glState().Issued(), (unsigned long long)glState().Elided());
+		if (profiler.Enabled()) {
+			profiler.PrintSummary();
+			profiler.WriteCsv(profilePrefix);
+		}
+	}
+	if (tracePath != NULL)
+		traceWrite(tracePath);
 
 	// Close OpenGL window and terminate GLFW
 	glfwTerminate();
 
 	return 0;
 }
-
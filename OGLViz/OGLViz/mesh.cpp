@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <vector>
+
+#include <GL\\glew.h>
+#include <GLM\\glm\\glm.hpp>
+
+#include "headers\\objloader.hpp"
+#include "headers\\vboindexer.hpp"
+#include "headers\\mesh.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\trace.hpp"
+
+Mesh::Mesh()
+	: _vao(0), _vertexBuffer(0), _uvBuffer(0), _normalBuffer(0), _indexBuffer(0),
+	_vertexCount(0), _indexCount(0), _indexType(GL_UNSIGNED_SHORT)
+{
+}
+
+Mesh::~Mesh()
+{
+	glDeleteBuffers(1, &_vertexBuffer);
+	glDeleteBuffers(1, &_uvBuffer);
+	glDeleteBuffers(1, &_normalBuffer);
+	glDeleteBuffers(1, &_indexBuffer);
+	glDeleteVertexArrays(1, &_vao);
+}
+
+// one tightly packed float attribute per buffer
+static GLuint uploadAttribute(GLuint location, GLint size, const void* data, size_t bytes)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(location);
+	glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	return buffer;
+}
+
+bool Mesh::LoadOBJ(const char* path)
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	if (!loadOBJ(path, vertices, uvs, normals) || vertices.empty())
+		return false;
+	if (uvs.size() != vertices.size() || normals.size() != vertices.size()) {
+		printf("%s needs UVs and normals on every face\n", path);
+		return false;
+	}
+
+	std::vector<unsigned int> indices;
+	std::vector<glm::vec3> indexedVertices;
+	std::vector<glm::vec2> indexedUvs;
+	std::vector<glm::vec3> indexedNormals;
+	indexVBO(vertices, uvs, normals, indices, indexedVertices, indexedUvs, indexedNormals);
+	_vertexCount = (GLsizei)indexedVertices.size();
+	_indexCount = (GLsizei)indices.size();
+
+	glGenVertexArrays(1, &_vao);
+	glState().BindVertexArray(_vao);
+	_vertexBuffer = uploadAttribute(ATTRIB_POSITION, 3, &indexedVertices[0], indexedVertices.size() * sizeof(glm::vec3));
+	_uvBuffer = uploadAttribute(ATTRIB_UV, 2, &indexedUvs[0], indexedUvs.size() * sizeof(glm::vec2));
+	_normalBuffer = uploadAttribute(ATTRIB_NORMAL, 3, &indexedNormals[0], indexedNormals.size() * sizeof(glm::vec3));
+
+	// the element buffer binding is part of the VAO
+	glGenBuffers(1, &_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+	if (_vertexCount <= 65536) {
+		std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+		_indexType = GL_UNSIGNED_SHORT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), &shortIndices[0], GL_STATIC_DRAW);
+	}
+	else {
+		_indexType = GL_UNSIGNED_INT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	}
+	return true;
+}
+
+void Mesh::Draw() const
+{
+	TRACE_SCOPE("Mesh::Draw");
+	glState().BindVertexArray(_vao);
+	glDrawElements(GL_TRIANGLES, _indexCount, _indexType, (void*)0);
+}
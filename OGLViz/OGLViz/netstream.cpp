@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define closesocket_ closesocket
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define closesocket_ close
+#define INVALID_SOCKET (-1)
+#endif
+
+#include "headers/netstream.hpp"
+
+static const uint32_t NET_MAGIC = 0x544E5053; // "SPNT"
+static const uint8_t NET_VERSION = 2;
+// the stereo and level fields of AnalysisFrame, correlation through integratedLufs
+static const int NET_LEVELS = 10;
+// magic, version/frag, sequence, capture time, rate, bins, beats, bands, levels
+static const int NET_HEADER = 4 + 4 + 4 + 8 + 4 + 2 + 2 + 2 + 2 + 4 + 4 * NUM_BANDS + 4 * NET_LEVELS;
+static const int NET_FRAG_BINS = NET_MAX_DATAGRAM - NET_HEADER;
+// spectrum is sent as 0.5 dB steps over 0..127.5 dB
+static const float DB_STEP = 0.5f;
+// concealed bins fade out so a dead link doesn't freeze the picture
+static const float CONCEAL_DECAY = 0.85f;
+
+static void put16(uint8_t*& p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p += 2; }
+static void put32(uint8_t*& p, uint32_t v) { put16(p, v & 0xFFFF); put16(p, v >> 16); }
+static void put64(uint8_t*& p, uint64_t v) { put32(p, (uint32_t)v); put32(p, (uint32_t)(v >> 32)); }
+static void putf(uint8_t*& p, float f) { uint32_t v; memcpy(&v, &f, 4); put32(p, v); }
+static uint32_t get16(uint8_t const*& p) { uint32_t v = p[0] | (p[1] << 8); p += 2; return v; }
+static uint32_t get32(uint8_t const*& p) { uint32_t v = get16(p); return v | (get16(p) << 16); }
+static uint64_t get64(uint8_t const*& p) { uint64_t v = get32(p); return v | ((uint64_t)get32(p) << 32); }
+static float getf(uint8_t const*& p) { uint32_t v = get32(p); float f; memcpy(&f, &v, 4); return f; }
+
+static void putLevels(uint8_t*& p, AnalysisFrame const& frame) {
+	putf(p, frame.correlation);
+	putf(p, frame.balance);
+	putf(p, frame.midEnergy);
+	putf(p, frame.sideEnergy);
+	putf(p, frame.rmsDb);
+	putf(p, frame.peakDb);
+	putf(p, frame.truePeakDb);
+	putf(p, frame.momentaryLufs);
+	putf(p, frame.shortTermLufs);
+	putf(p, frame.integratedLufs);
+}
+
+static void getLevels(uint8_t const*& p, AnalysisFrame& frame) {
+	frame.correlation = getf(p);
+	frame.balance = getf(p);
+	frame.midEnergy = getf(p);
+	frame.sideEnergy = getf(p);
+	frame.rmsDb = getf(p);
+	frame.peakDb = getf(p);
+	frame.truePeakDb = getf(p);
+	frame.momentaryLufs = getf(p);
+	frame.shortTermLufs = getf(p);
+	frame.integratedLufs = getf(p);
+}
+
+static uint8_t quantise(float mag) {
+	if (mag <= 1.0f)
+		return 0;
+	float q = 20.0f * log10f(mag) / DB_STEP;
+	return q >= 255.0f ? 255 : (uint8_t)(q + 0.5f);
+}
+
+static float dequantise(uint8_t q) {
+	return q == 0 ? 0.0f : powf(10.0f, q * DB_STEP / 20.0f);
+}
+
+// "a.b.c.d:port"
+static bool parseGroup(const char* group, sockaddr_in& addr) {
+	char host[64];
+	const char* colon = strrchr(group, ':');
+	if (colon == NULL || colon - group >= (int)sizeof host) {
+		fprintf(stderr, "Multicast group '%s' should look like 239.255.42.1:4242\n", group);
+		return false;
+	}
+	memcpy(host, group, colon - group);
+	host[colon - group] = 0;
+	memset(&addr, 0, sizeof addr);
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((unsigned short)atoi(colon + 1));
+	if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+		fprintf(stderr, "Bad multicast address '%s'\n", host);
+		return false;
+	}
+	return true;
+}
+
+static bool startSockets() {
+#ifdef _WIN32
+	static bool started = false;
+	if (!started) {
+		WSADATA wsa;
+		if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+			fprintf(stderr, "WSAStartup failed\n");
+			return false;
+		}
+		started = true;
+	}
+#endif
+	return true;
+}
+
+SpectrumSender::SpectrumSender()
+	: _socket(INVALID_SOCKET), _addrLen(0)
+{
+}
+
+SpectrumSender::~SpectrumSender()
+{
+	Close();
+}
+
+bool SpectrumSender::Open(const char* group, int ttl)
+{
+	sockaddr_in addr;
+	if (!startSockets() || !parseGroup(group, addr))
+		return false;
+	_socket = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (_socket == (intptr_t)INVALID_SOCKET) {
+		perror("socket");
+		return false;
+	}
+	unsigned char hops = (unsigned char)ttl;
+	unsigned char loop = 1;     // local receivers too, one box setups and tests
+	setsockopt(_socket, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&hops, sizeof hops);
+	setsockopt(_socket, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&loop, sizeof loop);
+	memcpy(_addr, &addr, sizeof addr);
+	_addrLen = sizeof addr;
+	return true;
+}
+
+void SpectrumSender::Close()
+{
+	if (_socket != (intptr_t)INVALID_SOCKET)
+		closesocket_(_socket);
+	_socket = INVALID_SOCKET;
+}
+
+bool SpectrumSender::Send(AnalysisFrame const& frame)
+{
+	uint8_t packet[NET_MAX_DATAGRAM];
+	uint32_t binCount = frame.binCount;
+	uint32_t fragCount = binCount == 0 ? 1 : (binCount + NET_FRAG_BINS - 1) / NET_FRAG_BINS;
+	if (fragCount > MAX_FRAGMENTS)
+		return false;
+
+	for (uint32_t f = 0; f < fragCount; f++) {
+		uint32_t first = f * NET_FRAG_BINS;
+		uint32_t count = binCount - first < (uint32_t)NET_FRAG_BINS ? binCount - first : NET_FRAG_BINS;
+
+		uint8_t* p = packet;
+		put32(p, NET_MAGIC);
+		*p++ = NET_VERSION;
+		*p++ = (uint8_t)f;
+		*p++ = (uint8_t)fragCount;
+		*p++ = 0;
+		put32(p, frame.sequence);
+		put64(p, frame.captureTimeNs);
+		put32(p, frame.sampleRate);
+		put16(p, binCount);
+		put16(p, first);
+		put16(p, count);
+		put16(p, 0);
+		put32(p, frame.beatFlags);
+		for (int b = 0; b < NUM_BANDS; b++)
+			putf(p, frame.bands[b]);
+		putLevels(p, frame);
+		for (uint32_t i = 0; i < count; i++)
+			*p++ = quantise(frame.spectrum[first + i]);
+
+		int len = (int)(p - packet);
+		if (sendto(_socket, (const char*)packet, len, 0, (const sockaddr*)_addr, _addrLen) != len)
+			return false;
+	}
+	return true;
+}
+
+SpectrumReceiver::SpectrumReceiver()
+	: _socket(INVALID_SOCKET),
+	_delayNs(0),
+	_offsetNs(0),
+	_haveOffset(false),
+	_started(false),
+	_nextSeq(0),
+	_received(0),
+	_concealed(0),
+	_late(0),
+	_haveLast(false)
+{
+	// never hand out memory nothing was received into
+	memset(_slots, 0, sizeof _slots);
+	memset(&_last, 0, sizeof _last);
+}
+
+SpectrumReceiver::~SpectrumReceiver()
+{
+	Close();
+}
+
+bool SpectrumReceiver::Open(const char* group, int delayMs)
+{
+	sockaddr_in addr;
+	if (!startSockets() || !parseGroup(group, addr))
+		return false;
+	_delayNs = (uint64_t)delayMs * 1000000ull;
+	_socket = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (_socket == (intptr_t)INVALID_SOCKET) {
+		perror("socket");
+		return false;
+	}
+	int reuse = 1;
+	setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof reuse);
+
+	sockaddr_in local;
+	memset(&local, 0, sizeof local);
+	local.sin_family = AF_INET;
+	local.sin_port = addr.sin_port;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(_socket, (const sockaddr*)&local, sizeof local) != 0) {
+		perror("bind");
+		Close();
+		return false;
+	}
+	ip_mreq mreq;
+	mreq.imr_multiaddr = addr.sin_addr;
+	mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+	if (setsockopt(_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&mreq, sizeof mreq) != 0) {
+		perror("IP_ADD_MEMBERSHIP");
+		Close();
+		return false;
+	}
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(_socket, FIONBIO, &nonBlocking);
+#else
+	fcntl((int)_socket, F_SETFL, fcntl((int)_socket, F_GETFL) | O_NONBLOCK);
+#endif
+	return true;
+}
+
+void SpectrumReceiver::Close()
+{
+	if (_socket != (intptr_t)INVALID_SOCKET)
+		closesocket_(_socket);
+	_socket = INVALID_SOCKET;
+}
+
+void SpectrumReceiver::Poll(uint64_t nowNs)
+{
+	uint8_t packet[NET_MAX_DATAGRAM];
+	for (;;) {
+		int len = (int)recv(_socket, (char*)packet, sizeof packet, 0);
+		if (len <= 0)
+			break;
+		Receive(packet, len, nowNs);
+	}
+}
+
+void SpectrumReceiver::Receive(uint8_t const* data, int len, uint64_t nowNs)
+{
+	if (len < NET_HEADER)
+		return;
+	uint8_t const* p = data;
+	if (get32(p) != NET_MAGIC || p[0] != NET_VERSION)
+		return;
+	uint32_t frag = p[1];
+	uint32_t fragCount = p[2];
+	p += 4;
+	uint32_t sequence = get32(p);
+	uint64_t captureTimeNs = get64(p);
+	uint32_t sampleRate = get32(p);
+	uint32_t binCount = get16(p);
+	uint32_t first = get16(p);
+	uint32_t count = get16(p);
+	get16(p);
+	if (fragCount == 0 || fragCount > MAX_FRAGMENTS || frag >= fragCount ||
+		binCount > MAX_BINS || first + count > binCount || NET_HEADER + (int)count > len)
+		return;
+	_received++;
+
+	// transit = clock offset + network delay, the minimum is our best offset
+	int64_t transit = (int64_t)(nowNs - captureTimeNs);
+	if (!_haveOffset || transit < _offsetNs) {
+		_offsetNs = transit;
+		_haveOffset = true;
+	}
+
+	if (!_started) {
+		_nextSeq = sequence;
+		_started = true;
+	}
+	int32_t ahead = (int32_t)(sequence - _nextSeq);
+	if (ahead < 0 && ahead >= -JITTER_SLOTS) {
+		_late++;
+		return;
+	}
+	if (ahead < 0) {
+		// further back than any reordering: the sender restarted, start over from it
+		for (int i = 0; i < JITTER_SLOTS; i++)
+			_slots[i].used = false;
+		_nextSeq = sequence;
+	}
+	else if (ahead >= JITTER_SLOTS) {
+		// fell too far behind, or the sender restarted higher up: skip ahead
+		for (int i = 0; i < JITTER_SLOTS; i++)
+			_slots[i].used = false;
+		_nextSeq = sequence - (JITTER_SLOTS - 1);
+	}
+
+	Pending& slot = _slots[sequence % JITTER_SLOTS];
+	if (!slot.used || slot.frame.sequence != sequence) {
+		slot.used = true;
+		slot.fragCount = fragCount;
+		slot.fragMask = 0;
+		slot.frame.sequence = sequence;
+		slot.frame.captureTimeNs = captureTimeNs;
+		slot.frame.sampleRate = sampleRate;
+		slot.frame.binCount = binCount;
+		slot.frame.beatFlags = get32(p);
+		for (int b = 0; b < NUM_BANDS; b++)
+			slot.frame.bands[b] = getf(p);
+		getLevels(p, slot.frame);
+	}
+
+	p = data + NET_HEADER;
+	for (uint32_t i = 0; i < count; i++)
+		slot.frame.spectrum[first + i] = dequantise(p[i]);
+	slot.fragMask |= 1u << frag;
+}
+
+// fill the bins of missing fragments from the previous frame
+void SpectrumReceiver::Conceal(Pending& p)
+{
+	uint32_t perFrag = p.fragCount == 1 ? p.frame.binCount : (uint32_t)NET_FRAG_BINS;
+	for (uint32_t f = 0; f < p.fragCount; f++) {
+		if (p.fragMask & (1u << f))
+			continue;
+		uint32_t first = f * perFrag;
+		uint32_t end = first + perFrag < p.frame.binCount ? first + perFrag : p.frame.binCount;
+		for (uint32_t i = first; i < end; i++)
+			p.frame.spectrum[i] = _haveLast && i < _last.binCount ? _last.spectrum[i] * CONCEAL_DECAY : 0.0f;
+	}
+	_concealed++;
+}
+
+bool SpectrumReceiver::Next(uint64_t nowNs, AnalysisFrame& out)
+{
+	if (!_started)
+		return false;
+
+	// is anything at or after _nextSeq due yet?
+	int due = -1;
+	for (int k = 0; k < JITTER_SLOTS; k++) {
+		Pending& p = _slots[(_nextSeq + k) % JITTER_SLOTS];
+		if (p.used && p.frame.sequence == _nextSeq + k && DueNs(p.frame.captureTimeNs) <= nowNs) {
+			due = k;
+			break;
+		}
+	}
+	if (due < 0)
+		return false;
+	// nothing to conceal the missing ones from yet: start at the due frame
+	if (due > 0 && !_haveLast) {
+		_nextSeq += due;
+		due = 0;
+	}
+
+	Pending& p = _slots[_nextSeq % JITTER_SLOTS];
+	if (due == 0) {
+		if (p.fragMask != (1u << p.fragCount) - 1)
+			Conceal(p);
+		out = p.frame;
+		p.used = false;
+	}
+	else {
+		// _nextSeq never arrived but a later frame is already due
+		out = _last;
+		out.sequence = _nextSeq;
+		out.beatFlags = 0;
+		for (int b = 0; b < NUM_BANDS; b++)
+			out.bands[b] *= CONCEAL_DECAY;
+		for (uint32_t i = 0; i < out.binCount; i++)
+			out.spectrum[i] *= CONCEAL_DECAY;
+		_concealed++;
+	}
+	_nextSeq++;
+	_last = out;
+	_haveLast = true;
+	return true;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+#include "headers\\audiosource.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\offlineanalysis.hpp"
+
+OfflineAnalysis::OfflineAnalysis(AudioSource const& audio, int points, double fps)
+	: _audio(audio), _sampleRate(audio.SampleRate()), _points(points), _fps(fps), _position(0),
+	_fft(points, audio.SampleRate()), _features(points, audio.SampleRate()), _loudness((int)audio.SampleRate()),
+	_slots(1), _ahead(0), _produced(0), _consumed(0), _stopping(false), _waits(0)
+{
+}
+
+OfflineAnalysis::~OfflineAnalysis()
+{
+	Stop();
+}
+
+void OfflineAnalysis::Start(int ahead)
+{
+	if (ahead <= 0 || _worker.joinable())
+		return;
+	_ahead = std::min(ahead, (int)MAX_AHEAD);
+	_slots.resize(_ahead);
+	_stopping = false;
+	_worker = std::thread(&OfflineAnalysis::WorkerLoop, this);
+}
+
+void OfflineAnalysis::Stop()
+{
+	if (!_worker.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_space.notify_one();
+	_worker.join();
+}
+
+OfflineAnalysis::Slot const& OfflineAnalysis::Acquire(int index)
+{
+	if (_ahead == 0) {
+		Analyse(index, _slots[0]);
+		_produced++;
+		return _slots[0];
+	}
+	TRACE_SCOPE("OfflineAnalysis::Acquire");
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_produced <= index) {
+		_waits++;
+		while (_produced <= index)
+			_ready.wait(lock);
+	}
+	return _slots[index % _ahead];
+}
+
+void OfflineAnalysis::Release()
+{
+	if (_ahead == 0) {
+		_consumed++;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_consumed++;
+	}
+	_space.notify_one();
+}
+
+void OfflineAnalysis::WorkerLoop()
+{
+	TRACE_THREAD_NAME("offline analysis");
+	for (;;) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (!_stopping && _produced - _consumed >= _ahead)
+				_space.wait(lock);
+			if (_stopping)
+				break;
+			index = _produced;
+		}
+		// the slot is free until the renderer acquires it
+		Analyse(index, _slots[index % _ahead]);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_produced++;
+		}
+		_ready.notify_one();
+	}
+}
+
+void OfflineAnalysis::Analyse(int index, Slot& slot)
+{
+	TRACE_SCOPE("OfflineAnalysis::Analyse");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint64_t end = (uint64_t)((index + 1) * _sampleRate / _fps);
+	int hop = (int)(end - _position);
+	_left.resize(hop);
+	_right.resize(hop);
+	_mid.resize(hop);
+	_audio.Read(_position, hop, _left.data(), _right.data());
+	for (int s = 0; s < hop; s++)
+		_mid[s] = (_left[s] + _right[s]) * 0.5f * 32768.0f;
+	int tail = std::min(hop, _points);
+	slot.mid.assign(_mid.end() - tail, _mid.end());
+	_fft.CopyIn(slot.mid.data(), tail);
+	_fft.Transform();
+	// stamped with the stream position, not the wall clock
+	_features.Process(_fft, (uint64_t)(end * 1000000000.0 / _sampleRate), slot.frame);
+	_stereo.Process(_left.data(), _right.data(), hop, slot.frame);
+	_loudness.Process(_left.data(), _right.data(), hop, slot.frame);
+	_position = end;
+	slot.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
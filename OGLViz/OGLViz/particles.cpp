@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <vector>
+
+#include <GL\\glew.h>
+
+#include "headers\\shader.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\particles.hpp"
+
+// seconds a particle lives, give or take half
+static const float LIFETIME = 4.0f;
+// share of the cloud reborn per second without beats, and on a beat
+static const double TRICKLE_RATE = 0.15;
+static const double BURST_FRACTION = 0.12;
+// world units per second at birth
+static const float TRICKLE_SPEED = 0.6f;
+static const float BURST_SPEED = 3.0f;
+static const float SPRITE_SIZE = 0.012f;
+
+ParticleSystem::ParticleSystem()
+	: _updateProgram(0), _program(0), _particleCountID(-1), _spawnStartID(-1), _spawnCountID(-1),
+	_spawnSpeedID(-1), _lifetimeID(-1), _seedID(-1), _sizeID(-1), _count(0), _current(0),
+	_spawnCursor(0), _spawnCarry(0), _lastSequence(0), _anySequence(false), _lastTime(-1.0), _frame(0)
+{
+	_buffers[0] = _buffers[1] = 0;
+	_updateVaos[0] = _updateVaos[1] = 0;
+	_drawVaos[0] = _drawVaos[1] = 0;
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	glDeleteVertexArrays(2, _updateVaos);
+	glDeleteVertexArrays(2, _drawVaos);
+	glDeleteBuffers(2, _buffers);
+	glState().ForgetProgram(_updateProgram);
+	glDeleteProgram(_updateProgram);
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+}
+
+bool ParticleSystem::Init(int count, const char* updateShaderPath, const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	static const char* varyings[] = { "outPosition", "outVelocity" };
+	_updateProgram = LoadFeedbackShader(updateShaderPath, varyings, 2);
+	GLuint program = LoadShaders(vertexShaderPath, fragmentShaderPath);
+	if (_updateProgram == 0 || program == 0)
+		return false;
+	SetProgram(program);
+	_particleCountID = glGetUniformLocation(_updateProgram, "particleCount");
+	_spawnStartID = glGetUniformLocation(_updateProgram, "spawnStart");
+	_spawnCountID = glGetUniformLocation(_updateProgram, "spawnCount");
+	_spawnSpeedID = glGetUniformLocation(_updateProgram, "spawnSpeed");
+	_lifetimeID = glGetUniformLocation(_updateProgram, "lifetime");
+	_seedID = glGetUniformLocation(_updateProgram, "seed");
+	_count = count < 1 ? 1 : (count > MAX_PARTICLES ? MAX_PARTICLES : count);
+
+	// everything starts dead, zero life left
+	std::vector<float> zeros((size_t)_count * 8, 0.0f);
+	glGenBuffers(2, _buffers);
+	glGenVertexArrays(2, _updateVaos);
+	glGenVertexArrays(2, _drawVaos);
+	for (int i = 0; i < 2; i++) {
+		glBindBuffer(GL_ARRAY_BUFFER, _buffers[i]);
+		glBufferData(GL_ARRAY_BUFFER, zeros.size() * sizeof(float), &zeros[0], GL_DYNAMIC_COPY);
+		for (int instanced = 0; instanced < 2; instanced++) {
+			glBindVertexArray(instanced ? _drawVaos[i] : _updateVaos[i]);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float)));
+			glVertexAttribDivisor(0, instanced);
+			glVertexAttribDivisor(1, instanced);
+		}
+	}
+	glBindVertexArray(0);
+	// raw VAO binds above
+	glState().Invalidate();
+	return glGetError() == GL_NO_ERROR;
+}
+
+void ParticleSystem::SetProgram(GLuint program)
+{
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+	_program = program;
+	_sizeID = glGetUniformLocation(_program, "size");
+}
+
+void ParticleSystem::Update(AnalysisFrame const* audio, double seconds)
+{
+	TRACE_SCOPE("ParticleSystem::Update");
+	double dt = _lastTime < 0 ? 0.0 : seconds - _lastTime;
+	dt = dt < 0 ? 0 : (dt > 0.1 ? 0.1 : dt);
+	_lastTime = seconds;
+
+	// a beat belongs to one analysis frame, however often it is drawn
+	bool beat = false;
+	if (audio != NULL) {
+		beat = (!_anySequence || audio->sequence != _lastSequence) && (audio->beatFlags & BEAT_ANY);
+		_lastSequence = audio->sequence;
+		_anySequence = true;
+	}
+	_spawnCarry += _count * TRICKLE_RATE * dt;
+	if (beat)
+		_spawnCarry += _count * BURST_FRACTION;
+	int spawnCount = (int)_spawnCarry;
+	_spawnCarry -= spawnCount;
+	spawnCount = spawnCount > _count ? _count : spawnCount;
+
+	glState().UseProgram(_updateProgram);
+	glState().Uniform1i(_particleCountID, _count);
+	glState().Uniform1i(_spawnStartID, _spawnCursor);
+	glState().Uniform1i(_spawnCountID, spawnCount);
+	glState().Uniform1f(_spawnSpeedID, beat ? BURST_SPEED : TRICKLE_SPEED);
+	glState().Uniform1f(_lifetimeID, LIFETIME);
+	glUniform1ui(_seedID, _frame++ * 2654435761u);
+	_spawnCursor = (_spawnCursor + spawnCount) % _count;
+
+	glState().BindVertexArray(_updateVaos[_current]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _buffers[_current ^ 1]);
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, _count);
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	_current ^= 1;
+}
+
+void ParticleSystem::Draw()
+{
+	TRACE_SCOPE("ParticleSystem::Draw");
+	glState().UseProgram(_program);
+	glState().Uniform1f(_sizeID, SPRITE_SIZE);
+	glState().BindVertexArray(_drawVaos[_current]);
+	// glow adds up, and sprites don't hide each other
+	glState().Set(RenderState::DEPTH_TEST, true);
+	glState().DepthMask(false);
+	glState().Set(RenderState::BLEND, true);
+	glState().BlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, _count);
+	glState().DepthMask(true);
+}
@@ -0,0 +1,252 @@
+#include <stdio.h>
+
+#include <GL\\glew.h>
+
+#include "headers\\shader.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\shadermanager.hpp"
+#include "headers\\profiler.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\postprocess.hpp"
+
+static const char* postVertexShaderLocation = "shaders\\postVtxShader.txt";
+static const char* passFragmentShaderLocations[PostProcess::PASS_COUNT] = {
+	"shaders\\bloomDownFragShader.txt",
+	"shaders\\blurFragShader.txt",
+	"shaders\\trailsFragShader.txt",
+	"shaders\\compositeFragShader.txt",
+};
+// brightness where the glow starts, with a soft knee below it
+static const float BLOOM_THRESHOLD = 0.6f;
+
+PostProcess::PostProcess()
+	: _vao(0), _sceneFramebuffer(0), _sceneColor(0), _sceneDepth(0), _width(0), _height(0),
+	_bloomStrength(0.0f), _trailPersistence(0.0f), _historyIndex(0)
+{
+	for (int i = 0; i < PASS_COUNT; i++) {
+		_programs[i].program = 0;
+		_programs[i].texelSizeID = _programs[i].thresholdID = _programs[i].directionID = -1;
+		_programs[i].persistenceID = _programs[i].bloomStrengthID = _programs[i].trailStrengthID = -1;
+	}
+	_history[0] = _history[1] = NULL;
+}
+
+PostProcess::~PostProcess()
+{
+	for (int i = 0; i < PASS_COUNT; i++) {
+		glState().ForgetProgram(_programs[i].program);
+		glDeleteProgram(_programs[i].program);
+	}
+	glDeleteFramebuffers(1, &_sceneFramebuffer);
+	glDeleteTextures(1, &_sceneColor);
+	glDeleteRenderbuffers(1, &_sceneDepth);
+	glDeleteVertexArrays(1, &_vao);
+}
+
+bool PostProcess::Init(float bloomStrength, float trailPersistence)
+{
+	_bloomStrength = bloomStrength;
+	_trailPersistence = trailPersistence;
+	for (int i = 0; i < PASS_COUNT; i++) {
+		GLuint program = LoadShaders(postVertexShaderLocation, passFragmentShaderLocations[i]);
+		if (program == 0) {
+			fprintf(stderr, "Post process could not build %s\n", passFragmentShaderLocations[i]);
+			return false;
+		}
+		SetProgram(i, program);
+	}
+	glGenFramebuffers(1, &_sceneFramebuffer);
+	glGenTextures(1, &_sceneColor);
+	glGenRenderbuffers(1, &_sceneDepth);
+	// the quad comes from gl_VertexID, the VAO is only there for core profile
+	glGenVertexArrays(1, &_vao);
+	return glGetError() == GL_NO_ERROR;
+}
+
+void PostProcess::Watch(ShaderManager& shaders)
+{
+	for (int i = 0; i < PASS_COUNT; i++)
+		shaders.Watch(postVertexShaderLocation, passFragmentShaderLocations[i], [this, i](GLuint program) {
+			SetProgram(i, program);
+		});
+}
+
+void PostProcess::SetProgram(int pass, GLuint program)
+{
+	Program& p = _programs[pass];
+	glState().ForgetProgram(p.program);
+	glDeleteProgram(p.program);
+	p.program = program;
+	p.texelSizeID = glGetUniformLocation(program, "texelSize");
+	p.thresholdID = glGetUniformLocation(program, "threshold");
+	p.directionID = glGetUniformLocation(program, "direction");
+	p.persistenceID = glGetUniformLocation(program, "persistence");
+	p.bloomStrengthID = glGetUniformLocation(program, "bloomStrength");
+	p.trailStrengthID = glGetUniformLocation(program, "trailStrength");
+
+	// samplers sit on fixed units, set once per program
+	static const struct { const char* name; int unit; } samplers[] = {
+		{ "source", 0 }, { "scene", 0 }, { "history", 1 }, { "trails", 1 },
+		{ "bloom0", 2 }, { "bloom1", 3 }, { "bloom2", 4 }, { "bloom3", 5 },
+	};
+	glState().UseProgram(program);
+	for (size_t i = 0; i < sizeof(samplers) / sizeof(samplers[0]); i++)
+		glState().Uniform1i(glGetUniformLocation(program, samplers[i].name), samplers[i].unit);
+}
+
+bool PostProcess::AllocateScene(int width, int height)
+{
+	// on a resize the composite last left unit 5 active, and the bind is elided:
+	// it still has to select unit 0 or the storage below lands on a bloom level
+	glState().BindTexture(0, _sceneColor);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindRenderbuffer(GL_RENDERBUFFER, _sceneDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, _sceneFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _sceneColor, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _sceneDepth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Post process scene target incomplete (0x%x)\n", status);
+		return false;
+	}
+	_width = width;
+	_height = height;
+
+	// the old trails don't line up with the new size, start them black
+	for (int i = 0; i < 2; i++) {
+		_pool.Release(_history[i]);
+		_history[i] = NULL;
+	}
+	if (_trailPersistence > 0.0f) {
+		const GLfloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 2; i++) {
+			_history[i] = _pool.Acquire(width / 2, height / 2);
+			if (_history[i] == NULL)
+				continue;
+			glBindFramebuffer(GL_FRAMEBUFFER, _history[i]->framebuffer);
+			glClearBufferfv(GL_COLOR, 0, black);
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, _sceneFramebuffer);
+	return true;
+}
+
+GLuint PostProcess::Begin(int width, int height)
+{
+	width = width > 0 ? width : 1;
+	height = height > 0 ? height : 1;
+	if (_width != width || _height != height)
+		AllocateScene(width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, _sceneFramebuffer);
+	glViewport(0, 0, _width, _height);
+	return _sceneFramebuffer;
+}
+
+void PostProcess::DrawInto(RenderTarget const* target)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+	glViewport(0, 0, target->width, target->height);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void PostProcess::Bloom(RenderTarget* levels[BLOOM_LEVELS])
+{
+	FrameProfiler& profiler = frameProfiler();
+	{
+		ProfileScope scope(profiler, "bloom downsample");
+		TRACE_SCOPE("bloom downsample");
+		Program const& down = _programs[DOWNSAMPLE];
+		glState().UseProgram(down.program);
+		GLuint source = _sceneColor;
+		int sourceWidth = _width, sourceHeight = _height;
+		for (int i = 0; i < BLOOM_LEVELS; i++) {
+			levels[i] = _pool.Acquire(sourceWidth / 2, sourceHeight / 2);
+			if (levels[i] == NULL)
+				return;
+			glUniform2f(down.texelSizeID, 1.0f / sourceWidth, 1.0f / sourceHeight);
+			// only the first level cuts, the rest just halve
+			glState().Uniform1f(down.thresholdID, i == 0 ? BLOOM_THRESHOLD : -1.0f);
+			glState().BindTexture(0, source);
+			DrawInto(levels[i]);
+			source = levels[i]->texture;
+			sourceWidth = levels[i]->width;
+			sourceHeight = levels[i]->height;
+		}
+	}
+
+	ProfileScope scope(profiler, "bloom blur");
+	TRACE_SCOPE("bloom blur");
+	Program const& blur = _programs[BLUR];
+	glState().UseProgram(blur.program);
+	for (int i = 0; i < BLOOM_LEVELS; i++) {
+		RenderTarget* level = levels[i];
+		RenderTarget* temporary = _pool.Acquire(level->width, level->height);
+		if (temporary == NULL)
+			return;
+		glUniform2f(blur.directionID, 1.0f / level->width, 0.0f);
+		glState().BindTexture(0, level->texture);
+		DrawInto(temporary);
+		glUniform2f(blur.directionID, 0.0f, 1.0f / level->height);
+		glState().BindTexture(0, temporary->texture);
+		DrawInto(level);
+		_pool.Release(temporary);
+	}
+}
+
+void PostProcess::Trails()
+{
+	ProfileScope scope(frameProfiler(), "trails");
+	TRACE_SCOPE("trails");
+	RenderTarget* previous = _history[_historyIndex];
+	RenderTarget* next = _history[_historyIndex ^ 1];
+	if (previous == NULL || next == NULL)
+		return;
+	Program const& trails = _programs[TRAILS];
+	glState().UseProgram(trails.program);
+	glState().Uniform1f(trails.persistenceID, _trailPersistence);
+	glState().BindTexture(0, _sceneColor);
+	glState().BindTexture(1, previous->texture);
+	DrawInto(next);
+	_historyIndex ^= 1;
+}
+
+void PostProcess::End(GLuint output)
+{
+	TRACE_SCOPE("PostProcess::End");
+	glState().Set(RenderState::DEPTH_TEST, false);
+	glState().Set(RenderState::BLEND, false);
+	glState().BindVertexArray(_vao);
+
+	RenderTarget* levels[BLOOM_LEVELS] = {};
+	if (_bloomStrength > 0.0f)
+		Bloom(levels);
+	if (_trailPersistence > 0.0f)
+		Trails();
+
+	{
+		ProfileScope scope(frameProfiler(), "composite");
+		TRACE_SCOPE("composite");
+		Program const& composite = _programs[COMPOSITE];
+		glBindFramebuffer(GL_FRAMEBUFFER, output);
+		glViewport(0, 0, _width, _height);
+		glState().UseProgram(composite.program);
+		bool bloom = levels[BLOOM_LEVELS - 1] != NULL;
+		RenderTarget const* trails = _trailPersistence > 0.0f ? _history[_historyIndex] : NULL;
+		glState().Uniform1f(composite.bloomStrengthID, bloom ? _bloomStrength : 0.0f);
+		glState().Uniform1f(composite.trailStrengthID, trails != NULL ? 1.0f : 0.0f);
+		glState().BindTexture(0, _sceneColor);
+		glState().BindTexture(1, trails != NULL ? trails->texture : 0);
+		for (int i = 0; i < BLOOM_LEVELS; i++)
+			glState().BindTexture(2 + i, bloom ? levels[i]->texture : 0);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+
+	for (int i = 0; i < BLOOM_LEVELS; i++)
+		_pool.Release(levels[i]);
+	_pool.Trim();
+}
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+#include <GL\\glew.h>
+
+#include "headers\\profiler.hpp"
+
+// scope 0 is the whole frame, BeginFrame to EndFrame
+static const char* FRAME_SCOPE = "frame";
+
+FrameProfiler& frameProfiler()
+{
+	static FrameProfiler profiler;
+	return profiler;
+}
+
+FrameProfiler::FrameProfiler()
+	: _enabled(false), _frame(0), _scopeCount(0), _openQuery(-1), _dropped(0), _rejected(false)
+{
+	memset(_names, 0, sizeof(_names));
+	memset(_queries, 0, sizeof(_queries));
+	memset(_issued, 0, sizeof(_issued));
+	memset(_queryFrame, 0, sizeof(_queryFrame));
+}
+
+bool FrameProfiler::Init()
+{
+	glGenQueries(QUERY_FRAMES * MAX_SCOPES, &_queries[0][0]);
+	Sample unknown = { -1.0f, -1.0f };
+	_samples.assign(WINDOW * MAX_SCOPES, unknown);
+	_names[0] = FRAME_SCOPE;
+	_scopeCount = 1;
+	_enabled = glGetError() == GL_NO_ERROR;
+	return _enabled;
+}
+
+int FrameProfiler::FindScope(const char* name)
+{
+	for (int i = 0; i < _scopeCount; i++)
+		if (_names[i] == name || strcmp(_names[i], name) == 0)
+			return i;
+	if (_scopeCount == MAX_SCOPES) {
+		if (!_rejected)
+			fprintf(stderr, "Profiler is full at %d scopes, \"%s\" and any later ones are not timed\n", MAX_SCOPES, name);
+		_rejected = true;
+		return -1;
+	}
+	_names[_scopeCount] = name;
+	return _scopeCount++;
+}
+
+// results of the queries issued QUERY_FRAMES ago in this slot
+void FrameProfiler::CollectQueries(int slot)
+{
+	uint64_t frame = _queryFrame[slot];
+	for (int i = 0; i < _scopeCount; i++) {
+		if (!_issued[slot][i])
+			continue;
+		_issued[slot][i] = false;
+		GLint available = 0;
+		glGetQueryObjectiv(_queries[slot][i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			_dropped++;
+			continue;
+		}
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(_queries[slot][i], GL_QUERY_RESULT, &elapsed);
+		if (_frame - frame < WINDOW)
+			At(frame, i).gpuMs = (float)(elapsed / 1e6);
+	}
+}
+
+void FrameProfiler::BeginFrame()
+{
+	if (!_enabled)
+		return;
+	_frame++;
+	int slot = (int)(_frame % QUERY_FRAMES);
+	CollectQueries(slot);
+	_queryFrame[slot] = _frame;
+	for (int i = 0; i < MAX_SCOPES; i++) {
+		Sample unknown = { -1.0f, -1.0f };
+		At(_frame, i) = unknown;
+	}
+	_frameStart = Clock::now();
+	_openQuery = -1;
+}
+
+void FrameProfiler::EndFrame()
+{
+	if (!_enabled)
+		return;
+	At(_frame, 0).cpuMs = std::chrono::duration<float, std::milli>(Clock::now() - _frameStart).count();
+}
+
+int FrameProfiler::Begin(const char* name)
+{
+	if (!_enabled || _frame == 0)
+		return -1;
+	int scope = FindScope(name);
+	if (scope < 0)
+		return -1;
+	int slot = (int)(_frame % QUERY_FRAMES);
+	// one query per scope and frame, and none inside another scope's
+	if (_openQuery < 0 && !_issued[slot][scope]) {
+		glBeginQuery(GL_TIME_ELAPSED, _queries[slot][scope]);
+		_issued[slot][scope] = true;
+		_openQuery = scope;
+	}
+	_start[scope] = Clock::now();
+	return scope;
+}
+
+void FrameProfiler::End(int scope)
+{
+	if (scope < 0)
+		return;
+	float ms = std::chrono::duration<float, std::milli>(Clock::now() - _start[scope]).count();
+	Sample& sample = At(_frame, scope);
+	// a scope entered twice in a frame adds up
+	sample.cpuMs = sample.cpuMs < 0 ? ms : sample.cpuMs + ms;
+	if (_openQuery == scope) {
+		glEndQuery(GL_TIME_ELAPSED);
+		_openQuery = -1;
+	}
+}
+
+// nearest rank p50/p95/p99 over the kept frames that ran the scope
+void FrameProfiler::Percentiles(int scope, bool gpu, double out[3], int& count) const
+{
+	std::vector<float> values;
+	uint64_t first = _frame >= WINDOW ? _frame - WINDOW + 1 : 1;
+	for (uint64_t f = first; f <= _frame; f++) {
+		float v = gpu ? At(f, scope).gpuMs : At(f, scope).cpuMs;
+		if (v >= 0)
+			values.push_back(v);
+	}
+	count = (int)values.size();
+	static const double ranks[3] = { 50, 95, 99 };
+	std::sort(values.begin(), values.end());
+	for (int i = 0; i < 3; i++) {
+		if (values.empty()) {
+			out[i] = -1;
+			continue;
+		}
+		size_t rank = (size_t)ceil(ranks[i] / 100.0 * values.size());
+		out[i] = values[rank > 0 ? rank - 1 : 0];
+	}
+}
+
+bool FrameProfiler::WriteCsv(const char* prefix) const
+{
+	if (!_enabled)
+		return false;
+	std::string tracePath = std::string(prefix) + "_trace.csv";
+	std::string summaryPath = std::string(prefix) + "_summary.csv";
+
+	FILE* file = NULL;
+	if (fopen_s(&file, tracePath.c_str(), "w") != 0 || file == NULL) {
+		fprintf(stderr, "Cannot write %s\n", tracePath.c_str());
+		return false;
+	}
+	fprintf(file, "frame,scope,cpu_ms,gpu_ms\n");
+	uint64_t first = _frame >= WINDOW ? _frame - WINDOW + 1 : 1;
+	for (uint64_t f = first; f <= _frame; f++)
+		for (int i = 0; i < _scopeCount; i++) {
+			Sample const& sample = At(f, i);
+			if (sample.cpuMs < 0)
+				continue;
+			if (sample.gpuMs < 0)
+				fprintf(file, "%llu,%s,%.4f,\n", (unsigned long long)f, _names[i], sample.cpuMs);
+			else
+				fprintf(file, "%llu,%s,%.4f,%.4f\n", (unsigned long long)f, _names[i], sample.cpuMs, sample.gpuMs);
+		}
+	fclose(file);
+
+	if (fopen_s(&file, summaryPath.c_str(), "w") != 0 || file == NULL) {
+		fprintf(stderr, "Cannot write %s\n", summaryPath.c_str());
+		return false;
+	}
+	fprintf(file, "scope,frames,cpu_p50,cpu_p95,cpu_p99,gpu_p50,gpu_p95,gpu_p99\n");
+	for (int i = 0; i < _scopeCount; i++) {
+		double cpu[3], gpu[3];
+		int cpuCount, gpuCount;
+		Percentiles(i, false, cpu, cpuCount);
+		Percentiles(i, true, gpu, gpuCount);
+		fprintf(file, "%s,%d,%.4f,%.4f,%.4f", _names[i], cpuCount, cpu[0], cpu[1], cpu[2]);
+		if (gpuCount > 0)
+			fprintf(file, ",%.4f,%.4f,%.4f\n", gpu[0], gpu[1], gpu[2]);
+		else
+			fprintf(file, ",,,\n");
+	}
+	fclose(file);
+	printf("Profile written to %s and %s\n", tracePath.c_str(), summaryPath.c_str());
+	return true;
+}
+
+void FrameProfiler::PrintSummary() const
+{
+	if (!_enabled)
+		return;
+	printf("%-12s %8s %8s %8s   %8s %8s %8s (ms)\n", "scope", "cpu p50", "p95", "p99", "gpu p50", "p95", "p99");
+	for (int i = 0; i < _scopeCount; i++) {
+		double cpu[3], gpu[3];
+		int cpuCount, gpuCount;
+		Percentiles(i, false, cpu, cpuCount);
+		Percentiles(i, true, gpu, gpuCount);
+		if (gpuCount > 0)
+			printf("%-12s %8.3f %8.3f %8.3f   %8.3f %8.3f %8.3f\n", _names[i], cpu[0], cpu[1], cpu[2], gpu[0], gpu[1], gpu[2]);
+		else
+			printf("%-12s %8.3f %8.3f %8.3f   %8s %8s %8s\n", _names[i], cpu[0], cpu[1], cpu[2], "-", "-", "-");
+	}
+	if (_dropped > 0)
+		printf("%u GPU timings dropped, not ready after %d frames\n", _dropped, (int)QUERY_FRAMES);
+}
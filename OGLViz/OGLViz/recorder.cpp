@@ -0,0 +1,160 @@
+//------------------------------------
+//  recorder.cpp
+//  Wave-in buffer pool
+//------------------------------------
+#include "windows.h"
+#include "headers\\fft.hpp"
+#include "headers\\trace.hpp"
+#include <stdio.h>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SampleIter::SampleIter(Recorder const& recorder)
+    : _iCur(0), _recorder(recorder)
+{
+    _pBuffer = recorder.GetData();
+    _iEnd = recorder.SampleCount();
+}
+
+BOOL Recorder::Start(Event& event)
+{
+    WaveFormat format((WORD)_nChannels, _cSamplePerSec, (WORD)_bitsPerSample);
+    _waveInDevice.Open(WAVE_MAPPER, format, event);
+    if (!_waveInDevice.Ok())
+    {
+        fprintf(stderr, "Cannot open wave input device (error %u)\n", _waveInDevice.GetError());
+        return FALSE;
+    }
+    if (_pBuf == 0)
+        Allocate();
+
+    for (int i = 0; i < _numBuf; i++)
+        Queue(i);
+
+    _isStarted = TRUE;
+    _iBuf = 0;
+    _waveInDevice.Start();
+    return TRUE;
+}
+
+void Recorder::Stop()
+{
+    if (_isStarted)
+    {
+        _waveInDevice.Reset();
+        for (int i = 0; i < _numBuf; i++)
+            _waveInDevice.UnPrepare(&_header[i]);
+        _waveInDevice.Close();
+        _isStarted = FALSE;
+    }
+    Release();
+}
+
+// Hand buffer i to the driver
+void Recorder::Queue(int i)
+{
+    _header[i].lpData = &_pBuf[i * _cbBuf];
+    _header[i].dwBufferLength = _cbBuf;
+    _header[i].dwBytesRecorded = 0;
+    _header[i].dwFlags = 0;
+    _header[i].dwLoops = 0;
+    _waveInDevice.Prepare(&_header[i]);
+    _waveInDevice.SendBuffer(&_header[i]);
+}
+
+// The current buffer has been consumed:
+// recycle it and move on to the next one
+BOOL Recorder::BufferDone()
+{
+    assert(IsBufferDone());
+    TRACE_INSTANT("Recorder::BufferDone");
+    _waveInDevice.UnPrepare(&_header[_iBuf]);
+    Queue(_iBuf);
+    _iBuf++;
+    if (_iBuf == _numBuf)
+        _iBuf = 0;
+    return TRUE;
+}
+
+int Recorder::PendingBuffers() const
+{
+    int cDone = 0;
+    for (int i = _iBuf; cDone < _numBuf && _header[i].IsDone(); )
+    {
+        cDone++;
+        if (++i == _numBuf)
+            i = 0;
+    }
+    return cDone;
+}
+
+// Must be called from the consumer thread, between BufferDone calls,
+// with no SampleIter alive: the pool memory is reallocated.
+// The device is only reset, never closed, so capture resumes at once.
+BOOL Recorder::Resize(int numBuf, int cSamples)
+{
+    if (numBuf < MIN_NUM_BUF)
+        numBuf = MIN_NUM_BUF;
+    if (numBuf > MAX_NUM_BUF)
+        numBuf = MAX_NUM_BUF;
+    if (cSamples <= 0)
+        return FALSE;
+    if (numBuf == _numBuf && cSamples == _cSamples)
+        return TRUE;
+
+    if (_isStarted)
+    {
+        // returns every queued buffer to us, marked as done
+        _waveInDevice.Reset();
+        for (int i = 0; i < _numBuf; i++)
+            _waveInDevice.UnPrepare(&_header[i]);
+    }
+    Release();
+
+    _numBuf = numBuf;
+    _cSamples = cSamples;
+    _cbBuf = cSamples * _cbSampleSize;
+    Allocate();
+    _iBuf = 0;
+
+    if (_isStarted)
+    {
+        for (int i = 0; i < _numBuf; i++)
+            Queue(i);
+        _waveInDevice.Start();
+    }
+    return TRUE;
+}
+
+void Recorder::CopyChannels(float* left, float* right) const
+{
+    assert(_bitsPerSample == 16);
+    const short* p = (const short*)GetData();
+    const float scale = 1.0f / 32768.0f;
+    int i = 0;
+    if (_nChannels == 1)
+    {
+        for (; i < _cSamples; i++)
+            left[i] = right[i] = p[i] * scale;
+        return;
+    }
+#if defined(_M_X64) || defined(__SSE2__)
+    // 4 frames (8 interleaved shorts) per step
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 4 <= _cSamples; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 2 * i));
+        // sign-extend the low (left) and high (right) halves of each pair
+        __m128i l = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        __m128i r = _mm_srai_epi32(v, 16);
+        _mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(l), vscale));
+        _mm_storeu_ps(right + i, _mm_mul_ps(_mm_cvtepi32_ps(r), vscale));
+    }
+#endif
+    for (; i < _cSamples; i++)
+    {
+        left[i] = p[2 * i] * scale;
+        right[i] = p[2 * i + 1] * scale;
+    }
+}
@@ -0,0 +1,176 @@
+#include <string.h>
+
+#include <GL\\glew.h>
+
+#include "headers\\renderstate.hpp"
+
+// never a real object name or enum, so the first call always goes through
+static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+static const GLenum capEnums[RenderState::CAP_COUNT] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE };
+
+RenderState& glState()
+{
+	static RenderState state;
+	return state;
+}
+
+RenderState::RenderState()
+	: _issued(0), _elided(0)
+{
+	Invalidate();
+}
+
+void RenderState::Invalidate()
+{
+	_program = UNKNOWN;
+	_vao = UNKNOWN;
+	_activeUnit = -1;
+	for (int i = 0; i < MAX_UNITS; i++)
+		_textures[i] = UNKNOWN;
+	for (int i = 0; i < CAP_COUNT; i++)
+		_caps[i] = -1;
+	_blendSrc = _blendDst = UNKNOWN;
+	_depthMask = -1;
+	_uniforms.clear();
+}
+
+void RenderState::ForgetProgram(GLuint program)
+{
+	for (std::unordered_map<uint64_t, UniformValue>::iterator it = _uniforms.begin(); it != _uniforms.end();) {
+		if ((GLuint)(it->first >> 32) == program)
+			it = _uniforms.erase(it);
+		else
+			++it;
+	}
+	if (_program == program)
+		_program = UNKNOWN;
+}
+
+void RenderState::UseProgram(GLuint program)
+{
+	if (program == _program) {
+		_elided++;
+		return;
+	}
+	glUseProgram(program);
+	_program = program;
+	_issued++;
+}
+
+void RenderState::BindVertexArray(GLuint vao)
+{
+	if (vao == _vao) {
+		_elided++;
+		return;
+	}
+	glBindVertexArray(vao);
+	_vao = vao;
+	_issued++;
+}
+
+void RenderState::ActiveTexture(int unit)
+{
+	if (unit == _activeUnit)
+		return;
+	glActiveTexture(GL_TEXTURE0 + unit);
+	_activeUnit = unit;
+	_issued++;
+}
+
+void RenderState::BindTexture(int unit, GLuint texture)
+{
+	// even when the bind is dropped: a glTex* call after it must reach this texture
+	ActiveTexture(unit);
+	if (texture == _textures[unit]) {
+		_elided++;
+		return;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	_textures[unit] = texture;
+	_issued++;
+}
+
+void RenderState::Set(Cap cap, bool enabled)
+{
+	if (_caps[cap] == (int)enabled) {
+		_elided++;
+		return;
+	}
+	if (enabled)
+		glEnable(capEnums[cap]);
+	else
+		glDisable(capEnums[cap]);
+	_caps[cap] = enabled;
+	_issued++;
+}
+
+void RenderState::BlendFunc(GLenum src, GLenum dst)
+{
+	if (src == _blendSrc && dst == _blendDst) {
+		_elided++;
+		return;
+	}
+	glBlendFunc(src, dst);
+	_blendSrc = src;
+	_blendDst = dst;
+	_issued++;
+}
+
+void RenderState::DepthMask(bool write)
+{
+	if (_depthMask == (int)write) {
+		_elided++;
+		return;
+	}
+	glDepthMask(write ? GL_TRUE : GL_FALSE);
+	_depthMask = write;
+	_issued++;
+}
+
+// records value as the one at location when it differs from the cached one
+bool RenderState::Changed(GLint location, UniformValue const& value)
+{
+	if (location < 0) {
+		// GL ignores these anyway
+		_elided++;
+		return false;
+	}
+	if (_program == UNKNOWN) {
+		_issued++;
+		return true;
+	}
+	uint64_t key = (uint64_t)_program << 32 | (uint32_t)location;
+	std::unordered_map<uint64_t, UniformValue>::iterator it = _uniforms.find(key);
+	if (it != _uniforms.end() && memcmp(&it->second, &value, sizeof(value)) == 0) {
+		_elided++;
+		return false;
+	}
+	_uniforms[key] = value;
+	_issued++;
+	return true;
+}
+
+void RenderState::Uniform1i(GLint location, GLint value)
+{
+	UniformValue v = { { (uint32_t)value, 0, 0, 0 } };
+	if (Changed(location, v))
+		glUniform1i(location, value);
+}
+
+void RenderState::Uniform1f(GLint location, GLfloat value)
+{
+	UniformValue v = { { 0, 0, 0, 0 } };
+	memcpy(&v.bits[0], &value, sizeof(value));
+	if (Changed(location, v))
+		glUniform1f(location, value);
+}
+
+void RenderState::Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+	GLfloat values[4] = { x, y, z, w };
+	UniformValue v;
+	memcpy(v.bits, values, sizeof(values));
+	if (Changed(location, v))
+		glUniform4f(location, x, y, z, w);
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+
+#include <GL\\glew.h>
+
+#include "headers\\renderstate.hpp"
+#include "headers\\rendertargetpool.hpp"
+
+RenderTargetPool::RenderTargetPool()
+	: _allocated(0), _created(0)
+{
+	for (int i = 0; i < MAX_TARGETS; i++) {
+		_targets[i].framebuffer = _targets[i].texture = 0;
+		_targets[i].width = _targets[i].height = 0;
+		_targets[i].inUse = _targets[i].touched = false;
+	}
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	for (int i = 0; i < MAX_TARGETS; i++)
+		Destroy(_targets[i]);
+}
+
+bool RenderTargetPool::Create(RenderTarget& target, int width, int height)
+{
+	glGenTextures(1, &target.texture);
+	glState().BindTexture(0, target.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glGenFramebuffers(1, &target.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Pooled %dx%d target incomplete (0x%x)\n", width, height, status);
+		Destroy(target);
+		return false;
+	}
+	target.width = width;
+	target.height = height;
+	_allocated++;
+	_created++;
+	return true;
+}
+
+void RenderTargetPool::Destroy(RenderTarget& target)
+{
+	if (target.framebuffer == 0 && target.texture == 0)
+		return;
+	if (target.width > 0)
+		_allocated--;
+	glDeleteFramebuffers(1, &target.framebuffer);
+	glDeleteTextures(1, &target.texture);
+	// the name may still be cached as bound, and GL hands it out again
+	glState().Invalidate();
+	target.framebuffer = target.texture = 0;
+	target.width = target.height = 0;
+	target.inUse = target.touched = false;
+}
+
+RenderTarget* RenderTargetPool::Acquire(int width, int height)
+{
+	width = width > 0 ? width : 1;
+	height = height > 0 ? height : 1;
+	RenderTarget* empty = NULL;
+	for (int i = 0; i < MAX_TARGETS; i++) {
+		RenderTarget& target = _targets[i];
+		if (target.framebuffer == 0) {
+			if (empty == NULL)
+				empty = &target;
+			continue;
+		}
+		if (!target.inUse && target.width == width && target.height == height) {
+			target.inUse = target.touched = true;
+			return &target;
+		}
+	}
+	if (empty == NULL) {
+		fprintf(stderr, "Render target pool exhausted at %d targets\n", (int)MAX_TARGETS);
+		return NULL;
+	}
+	if (!Create(*empty, width, height))
+		return NULL;
+	empty->inUse = empty->touched = true;
+	return empty;
+}
+
+void RenderTargetPool::Release(RenderTarget* target)
+{
+	if (target != NULL)
+		target->inUse = false;
+}
+
+void RenderTargetPool::Trim()
+{
+	for (int i = 0; i < MAX_TARGETS; i++) {
+		RenderTarget& target = _targets[i];
+		if (target.framebuffer != 0 && !target.inUse && !target.touched)
+			Destroy(target);
+		target.touched = false;
+	}
+}
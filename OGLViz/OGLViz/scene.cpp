@@ -0,0 +1,226 @@
+#include <stdio.h>
+
+#include <GL\\glew.h>
+#include <GLM\\glm\\glm.hpp>
+
+#include "headers\\shader.hpp"
+#include "headers\\texture.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\shadermanager.hpp"
+#include "headers\\profiler.hpp"
+#include "headers\\scene.hpp"
+
+static const char* vertexShaderLocation = "shaders\\vtxShader.txt";
+static const char* fragmentShaderLocation = "shaders\\fragShader.txt";
+static const char* uvLocation = "resources\\uvmap.DDS";
+static const char* meshLocation = "resources\\suzanne.obj";
+static const char* barVertexShaderLocation = "shaders\\barVtxShader.txt";
+static const char* barFragmentShaderLocation = "shaders\\barFragShader.txt";
+static const char* barTextureVertexShaderLocation = "shaders\\barTextureVtxShader.txt";
+static const char* spectrogramVertexShaderLocation = "shaders\\spectrogramVtxShader.txt";
+static const char* spectrogramFragmentShaderLocation = "shaders\\spectrogramFragShader.txt";
+static const char* particleUpdateShaderLocation = "shaders\\particleUpdateVtxShader.txt";
+static const char* particleVertexShaderLocation = "shaders\\particleVtxShader.txt";
+static const char* particleFragmentShaderLocation = "shaders\\particleFragShader.txt";
+static const char* waveformVertexShaderLocation = "shaders\\waveformVtxShader.txt";
+static const char* waveformFragmentShaderLocation = "shaders\\waveformFragShader.txt";
+
+Scene::Scene()
+	: _program(0), _textureID(-1), _texture(0), _barCount(0), _historyRows(0), _particleCount(0), _spectrum(0), _spectrumBins(0), _waveformWindow(0), _lastTime(0)
+{
+}
+
+Scene::~Scene()
+{
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+	glDeleteTextures(1, &_texture);
+}
+
+bool Scene::Init(int barCount, int historyRows, int particleCount)
+{
+	_barCount = barCount;
+	_historyRows = historyRows;
+	_particleCount = particleCount;
+
+	// Accept fragment if it closer to the camera than the former one
+	glDepthFunc(GL_LESS);
+	// Cull triangles which normal is not towards the camera
+	glEnable(GL_CULL_FACE);
+	// Dark blue background
+	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
+
+	// Create and compile our GLSL program from the shaders
+	_program = LoadShaders(vertexShaderLocation, fragmentShaderLocation);
+	if (_program == 0) {
+		fprintf(stderr, "Scene could not build %s\n", vertexShaderLocation);
+		return false;
+	}
+	// Camera, light and audio state go to every program through uniform blocks
+	if (!_uniforms.Init()) {
+		fprintf(stderr, "Scene uniform block initialization failed\n");
+		return false;
+	}
+	_texture = loadDDS(uvLocation);
+	_textureID = glGetUniformLocation(_program, "myTextureSampler");
+	// Read our .obj file into a VBO/VAO, attribute layout is recorded once here
+	if (!_mesh.LoadOBJ(meshLocation)) {
+		fprintf(stderr, "Scene mesh loading failed\n");
+		return false;
+	}
+	if (!_bars.Init(MAX_BARS, barVertexShaderLocation, barFragmentShaderLocation)) {
+		fprintf(stderr, "Scene spectrum bar initialization failed\n");
+		return false;
+	}
+	if (_historyRows > 0 &&
+		!_spectrogram.Init(_historyRows, SPECTROGRAM_COLUMNS, spectrogramVertexShaderLocation, spectrogramFragmentShaderLocation)) {
+		fprintf(stderr, "Scene spectrogram initialization failed\n");
+		return false;
+	}
+	if (_particleCount > 0 &&
+		!_particles.Init(_particleCount, particleUpdateShaderLocation, particleVertexShaderLocation, particleFragmentShaderLocation)) {
+		fprintf(stderr, "Scene particle initialization failed\n");
+		return false;
+	}
+
+	// setup above used raw GL calls, start the state cache from scratch
+	glState().Invalidate();
+	// Set our "myTextureSampler" sampler to use Texture Unit 0
+	glState().UseProgram(_program);
+	glState().Uniform1i(_textureID, 0);
+	return true;
+}
+
+bool Scene::UseSpectrumTexture(GLuint spectrum, int binCount)
+{
+	if (!_bars.InitTextureSource(barTextureVertexShaderLocation, barFragmentShaderLocation)) {
+		fprintf(stderr, "Scene could not build %s\n", barTextureVertexShaderLocation);
+		return false;
+	}
+	_spectrum = spectrum;
+	_spectrumBins = binCount;
+	return true;
+}
+
+bool Scene::UseWaveform(int windowSamples, bool triggered)
+{
+	// twice the window, so a trigger has a window's worth of history to search
+	if (!_waveform.Init(2 * windowSamples, waveformVertexShaderLocation, waveformFragmentShaderLocation)) {
+		fprintf(stderr, "Scene waveform initialization failed\n");
+		return false;
+	}
+	_waveform.SetWindow(windowSamples, triggered);
+	_waveformWindow = windowSamples;
+	return true;
+}
+
+void Scene::PushSamples(const float* samples, int count)
+{
+	if (_waveformWindow > 0)
+		_waveform.Append(samples, count);
+}
+
+void Scene::PushFrame(AnalysisFrame const& frame)
+{
+	if (_historyRows > 0)
+		_spectrogram.Update(frame);
+}
+
+void Scene::Watch(ShaderManager& shaders)
+{
+	shaders.Watch(vertexShaderLocation, fragmentShaderLocation, [this](GLuint program) {
+		glState().ForgetProgram(_program);
+		glDeleteProgram(_program);
+		_program = program;
+		_textureID = glGetUniformLocation(_program, "myTextureSampler");
+		glState().UseProgram(_program);
+		glState().Uniform1i(_textureID, 0);
+	});
+	shaders.Watch(barVertexShaderLocation, barFragmentShaderLocation, [this](GLuint program) {
+		_bars.SetProgram(program);
+	});
+	if (_spectrum != 0)
+		shaders.Watch(barTextureVertexShaderLocation, barFragmentShaderLocation, [this](GLuint program) {
+			_bars.SetTextureProgram(program);
+		});
+	if (_historyRows > 0)
+		shaders.Watch(spectrogramVertexShaderLocation, spectrogramFragmentShaderLocation, [this](GLuint program) {
+			_spectrogram.SetProgram(program);
+		});
+	// the update program is linked with its feedback outputs, only the sprites reload
+	if (_particleCount > 0)
+		shaders.Watch(particleVertexShaderLocation, particleFragmentShaderLocation, [this](GLuint program) {
+			_particles.SetProgram(program);
+		});
+	if (_waveformWindow > 0)
+		shaders.Watch(waveformVertexShaderLocation, waveformFragmentShaderLocation, [this](GLuint program) {
+			_waveform.SetProgram(program);
+		});
+}
+
+void Scene::Render(glm::mat4 const& projection, glm::mat4 const& view, AnalysisFrame const* audio,
+	double seconds, int width, int height)
+{
+	FrameProfiler& profiler = frameProfiler();
+	{
+		ProfileScope scope(profiler, "clear");
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	// Send our transformation and the audio state to every shader at once,
+	// through the "FrameBlock" and "AudioBlock" uniform blocks
+	int uniformScope = profiler.Begin("uniforms");
+	glm::mat4 model = glm::mat4(1.0f);
+	FrameUniforms frameUniforms;
+	frameUniforms.projection = projection;
+	frameUniforms.view = view;
+	frameUniforms.model = model;
+	frameUniforms.mvp = projection * view * model;
+	frameUniforms.lightPosition = glm::vec4(4, 4, 4, 1);
+	frameUniforms.viewport = glm::vec4((float)width, (float)height, (float)seconds, (float)(seconds - _lastTime));
+	_lastTime = seconds;
+	_uniforms.Update(frameUniforms, audio, seconds);
+	profiler.End(uniformScope);
+
+	{
+		ProfileScope scope(profiler, "mesh");
+		glState().UseProgram(_program);
+		glState().Set(RenderState::DEPTH_TEST, true);
+		glState().Set(RenderState::BLEND, false);
+		// Bind our texture in Texture Unit 0
+		glState().BindTexture(0, _texture);
+		_mesh.Draw();
+	}
+
+	// advanced and drawn without leaving the GPU, reacting to the AudioBlock
+	if (_particleCount > 0) {
+		{
+			ProfileScope scope(profiler, "particle update");
+			_particles.Update(audio, seconds);
+		}
+		ProfileScope scope(profiler, "particle draw");
+		_particles.Draw();
+	}
+
+	// every bar in one instanced draw, heights straight from the GPU transform when there is one
+	if (_spectrum != 0 || audio != NULL) {
+		ProfileScope scope(profiler, "bars");
+		if (_spectrum != 0)
+			_bars.UpdateFromTexture(_spectrum, _spectrumBins, _barCount);
+		else
+			_bars.Update(*audio, _barCount);
+		_bars.Draw();
+	}
+	// waterfall across the top half, rows from PushFrame
+	if (_historyRows > 0) {
+		ProfileScope scope(profiler, "spectrogram");
+		_spectrogram.Draw(-1.0f, 0.5f, 1.0f, 1.0f);
+	}
+	// one span per pixel column just under it, from the pyramid level matching the zoom
+	if (_waveformWindow > 0) {
+		ProfileScope scope(profiler, "waveform");
+		_waveform.Draw(-1.0f, 0.25f, 1.0f, 0.5f, width, height);
+	}
+
+	_uniforms.EndFrame();
+}
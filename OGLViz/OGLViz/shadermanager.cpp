@@ -0,0 +1,319 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+#include <GL\\glew.h>
+#include <GLFW\\glfw3.h>
+#include <GLM\\glm\\glm.hpp>
+
+#include "headers\\uniformblocks.hpp"
+#include "headers\\shadermanager.hpp"
+#include "headers\\trace.hpp"
+
+// seconds between modification time checks
+static const double POLL_INTERVAL = 0.25;
+
+// last write time in the file system's own units, 0 if missing;
+// st_mtime alone misses a second save within the same second
+static uint64_t modifiedTime(const std::string& path)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+		return 0;
+	return (uint64_t)info.ftLastWriteTime.dwHighDateTime << 32 | info.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return 0;
+	return (uint64_t)info.st_mtim.tv_sec * 1000000000u + info.st_mtim.tv_nsec;
+#endif
+}
+
+static bool readFile(const std::string& path, std::string& code)
+{
+	std::ifstream stream(path.c_str(), std::ios::in);
+	if (!stream.is_open())
+		return false;
+	std::stringstream sstr;
+	sstr << stream.rdbuf();
+	code = sstr.str();
+	return true;
+}
+
+// compile and link without querying any status, which is what would block
+static void startProgram(const std::string& vertexCode, const std::string& fragmentCode, GLuint& program,
+	GLuint& vertexShader, GLuint& fragmentShader)
+{
+	const char* vertexSource = vertexCode.c_str();
+	const char* fragmentSource = fragmentCode.c_str();
+	vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(vertexShader);
+	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+	glCompileShader(fragmentShader);
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+}
+
+static void appendLog(GLuint object, bool isProgram, const char* what, std::string& log)
+{
+	GLint length = 0;
+	if (isProgram)
+		glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+	else
+		glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+	if (length <= 1)
+		return;
+	std::vector<char> message(length + 1);
+	if (isProgram)
+		glGetProgramInfoLog(object, length, NULL, &message[0]);
+	else
+		glGetShaderInfoLog(object, length, NULL, &message[0]);
+	log += what;
+	log += ":\n";
+	log += &message[0];
+}
+
+// collects the logs and frees the shaders; program is deleted and 0 on failure
+static GLuint finishProgram(GLuint program, GLuint vertexShader, GLuint fragmentShader,
+	const std::string& vertexPath, const std::string& fragmentPath, std::string& log)
+{
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE) {
+		appendLog(vertexShader, false, vertexPath.c_str(), log);
+		appendLog(fragmentShader, false, fragmentPath.c_str(), log);
+		appendLog(program, true, "link", log);
+	}
+	glDetachShader(program, vertexShader);
+	glDetachShader(program, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	if (linked != GL_TRUE) {
+		glDeleteProgram(program);
+		return 0;
+	}
+	bindUniformBlocks(program);
+	return program;
+}
+
+ShaderManager::ShaderManager()
+	: _parallel(false), _workerWindow(NULL), _lastPoll(0.0), _quit(false), _reloads(0), _failures(0)
+{
+}
+
+ShaderManager::~ShaderManager()
+{
+	if (_worker.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_wake.notify_one();
+		_worker.join();
+	}
+	if (_workerWindow != NULL)
+		glfwDestroyWindow(_workerWindow);
+	// abandon parallel builds still in flight
+	for (size_t i = 0; i < _entries.size(); i++) {
+		if (!_entries[i].building || !_parallel)
+			continue;
+		glDeleteShader(_entries[i].build.vertexShader);
+		glDeleteShader(_entries[i].build.fragmentShader);
+		glDeleteProgram(_entries[i].build.program);
+	}
+}
+
+bool ShaderManager::Init(GLFWwindow* shareWith)
+{
+	_lastPoll = glfwGetTime();
+	if (GLEW_KHR_parallel_shader_compile) {
+		// let the driver pick how many compiler threads
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+		_parallel = true;
+		return true;
+	}
+	if (shareWith == NULL)
+		return true;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	_workerWindow = glfwCreateWindow(1, 1, "shader compiler", NULL, shareWith);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	// creating a window can leave its context current
+	glfwMakeContextCurrent(shareWith);
+	if (_workerWindow == NULL) {
+		fprintf(stderr, "No shared context for shader builds, reloads will compile on the render thread\n");
+		return true;
+	}
+	_worker = std::thread(&ShaderManager::WorkerLoop, this);
+	return true;
+}
+
+void ShaderManager::Watch(const char* vertexPath, const char* fragmentPath, SwapCallback onSwap)
+{
+	Entry entry;
+	entry.vertexPath = vertexPath;
+	entry.fragmentPath = fragmentPath;
+	entry.onSwap = onSwap;
+	entry.vertexTime = modifiedTime(entry.vertexPath);
+	entry.fragmentTime = modifiedTime(entry.fragmentPath);
+	entry.building = false;
+	entry.dirty = false;
+	entry.build.program = entry.build.vertexShader = entry.build.fragmentShader = 0;
+	_entries.push_back(entry);
+}
+
+void ShaderManager::PollFiles()
+{
+	for (size_t i = 0; i < _entries.size(); i++) {
+		Entry& entry = _entries[i];
+		uint64_t vertexTime = modifiedTime(entry.vertexPath);
+		uint64_t fragmentTime = modifiedTime(entry.fragmentPath);
+		// 0 while an editor has the file replaced, try again next poll
+		if (vertexTime == 0 || fragmentTime == 0)
+			continue;
+		if (vertexTime == entry.vertexTime && fragmentTime == entry.fragmentTime)
+			continue;
+		entry.vertexTime = vertexTime;
+		entry.fragmentTime = fragmentTime;
+		if (entry.building)
+			entry.dirty = true;
+		else
+			StartBuild(i);
+	}
+}
+
+void ShaderManager::StartBuild(size_t index)
+{
+	Entry& entry = _entries[index];
+	printf("Reloading %s + %s\n", entry.vertexPath.c_str(), entry.fragmentPath.c_str());
+	entry.building = true;
+	entry.dirty = false;
+
+	if (_worker.joinable()) {
+		Job job = { index, entry.vertexPath, entry.fragmentPath };
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_jobs.push_back(job);
+		}
+		_wake.notify_one();
+		return;
+	}
+
+	Result result;
+	result.entry = index;
+	result.program = 0;
+	std::string vertexCode, fragmentCode;
+	if (!readFile(entry.vertexPath, vertexCode) || !readFile(entry.fragmentPath, fragmentCode)) {
+		result.log = "could not read the sources";
+		Finish(result);
+		return;
+	}
+	startProgram(vertexCode, fragmentCode, entry.build.program, entry.build.vertexShader, entry.build.fragmentShader);
+	if (_parallel)
+		return;
+	// no way to build off this thread, take the hitch
+	result.program = finishProgram(entry.build.program, entry.build.vertexShader, entry.build.fragmentShader,
+		entry.vertexPath, entry.fragmentPath, result.log);
+	Finish(result);
+}
+
+void ShaderManager::Finish(Result& result)
+{
+	Entry& entry = _entries[result.entry];
+	entry.building = false;
+	if (result.program != 0) {
+		_reloads++;
+		printf("Reloaded %s + %s\n", entry.vertexPath.c_str(), entry.fragmentPath.c_str());
+		entry.onSwap(result.program);
+	}
+	else {
+		_failures++;
+		_lastError = entry.vertexPath + " + " + entry.fragmentPath + " failed, keeping the old program\n" + result.log;
+		fprintf(stderr, "%s\n", _lastError.c_str());
+	}
+	if (entry.dirty)
+		StartBuild(result.entry);
+}
+
+void ShaderManager::Update()
+{
+	double now = glfwGetTime();
+	if (now - _lastPoll >= POLL_INTERVAL) {
+		_lastPoll = now;
+		PollFiles();
+	}
+
+	if (_parallel) {
+		for (size_t i = 0; i < _entries.size(); i++) {
+			Entry& entry = _entries[i];
+			if (!entry.building)
+				continue;
+			GLint complete = GL_FALSE;
+			glGetProgramiv(entry.build.program, GL_COMPLETION_STATUS_KHR, &complete);
+			if (complete != GL_TRUE)
+				continue;
+			Result result;
+			result.entry = i;
+			result.program = finishProgram(entry.build.program, entry.build.vertexShader, entry.build.fragmentShader,
+				entry.vertexPath, entry.fragmentPath, result.log);
+			Finish(result);
+		}
+	}
+
+	if (_worker.joinable()) {
+		std::deque<Result> done;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			done.swap(_done);
+		}
+		for (size_t i = 0; i < done.size(); i++)
+			Finish(done[i]);
+	}
+}
+
+void ShaderManager::WorkerLoop()
+{
+	glfwMakeContextCurrent(_workerWindow);
+	TRACE_THREAD_NAME("shader worker");
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (_jobs.empty() && !_quit)
+				_wake.wait(lock);
+			if (_quit)
+				break;
+			job = _jobs.front();
+			_jobs.pop_front();
+		}
+
+		TRACE_SCOPE("build program");
+		Result result;
+		result.entry = job.entry;
+		result.program = 0;
+		std::string vertexCode, fragmentCode;
+		if (readFile(job.vertexPath, vertexCode) && readFile(job.fragmentPath, fragmentCode)) {
+			GLuint program, vertexShader, fragmentShader;
+			startProgram(vertexCode, fragmentCode, program, vertexShader, fragmentShader);
+			result.program = finishProgram(program, vertexShader, fragmentShader, job.vertexPath, job.fragmentPath, result.log);
+			// the program must be complete before the render context uses it
+			glFinish();
+		}
+		else
+			result.log = "could not read the sources";
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_done.push_back(result);
+	}
+	glfwMakeContextCurrent(NULL);
+}
@@ -11,14 +11,104 @@ using namespace std;
 #include <string.h>
 
 #include <GL\\glew.h>
+#include <GLM\\glm\\glm.hpp>
 
+#include "..\\headers\\uniformblocks.hpp"
+#include "..\\headers\\shader.hpp"
 
+// Program binary cache: <dir>/<key>.bin holds the format and the blob from
+// glGetProgramBinary, the key hashing both sources and the driver's
+// vendor, renderer and version strings. NULL disables it.
+static std::string ShaderCacheDirectory;
+static const unsigned int CACHE_MAGIC = 0x42474F4C; // "LOGB"
 
-GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path) {
+void setShaderCacheDirectory(const char* directory) {
+	ShaderCacheDirectory = directory != NULL ? directory : "";
+}
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+// FNV-1a, strings separated by their terminating zero
+static unsigned long long hashString(unsigned long long hash, const char* text) {
+	if (text == NULL)
+		text = "";
+	do {
+		hash ^= (unsigned char)*text;
+		hash *= 1099511628211ull;
+	} while (*text++ != 0);
+	return hash;
+}
+
+static std::string cachePath(const std::string& vertexCode, const std::string& fragmentCode) {
+	unsigned long long hash = 14695981039346656037ull;
+	hash = hashString(hash, vertexCode.c_str());
+	hash = hashString(hash, fragmentCode.c_str());
+	hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+	hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+	hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", hash);
+	return ShaderCacheDirectory + "/" + name;
+}
+
+static bool binariesSupported() {
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+// a linked program from the cache, or 0 on a miss or when the driver rejects the binary
+static GLuint loadCachedProgram(const std::string& path) {
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return 0;
+	unsigned int header[2];
+	if (!file.read((char*)header, sizeof(header)) || header[0] != CACHE_MAGIC)
+		return 0;
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (binary.empty())
+		return 0;
+
+	GLuint ProgramID = glCreateProgram();
+	glProgramBinary(ProgramID, (GLenum)header[1], &binary[0], (GLsizei)binary.size());
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if (Result != GL_TRUE) {
+		// driver update or different GPU, recompile and overwrite it
+		printf("Cached program %s rejected\n", path.c_str());
+		glDeleteProgram(ProgramID);
+		// an unknown format also raises an error; drain it so a caller's glGetError check
+		// after init doesn't fail (bounded, without a context glGetError never clears)
+		for (int i = 0; i < 16 && glGetError() != GL_NO_ERROR; i++)
+			;
+		return 0;
+	}
+	return ProgramID;
+}
+
+static void storeCachedProgram(const std::string& path, GLuint ProgramID) {
+	GLint length = 0;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(ProgramID, length, &length, &format, &binary[0]);
+
+	// write beside and rename, so a crash never leaves a truncated entry
+	std::string temporary = path + ".tmp";
+	std::ofstream file(temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		printf("Could not write program cache %s\n", temporary.c_str());
+		return;
+	}
+	unsigned int header[2] = { CACHE_MAGIC, (unsigned int)format };
+	file.write((const char*)header, sizeof(header));
+	file.write(&binary[0], length);
+	file.close();
+	remove(path.c_str());
+	rename(temporary.c_str(), path.c_str());
+}
+
+GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path) {
 
 	// Read the Vertex Shader code from the file
 	std::string VertexShaderCode;
@@ -45,6 +135,24 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
 		FragmentShaderStream.close();
 	}
 
+	// Try the program binary cache before compiling anything
+	bool UseCache = !ShaderCacheDirectory.empty() && binariesSupported();
+	std::string CachePath;
+	if (UseCache) {
+		CachePath = cachePath(VertexShaderCode, FragmentShaderCode);
+		GLuint CachedProgramID = loadCachedProgram(CachePath);
+		if (CachedProgramID != 0) {
+			printf("Loaded cached program for %s + %s\n", vertex_file_path, fragment_file_path);
+			// block bindings are not part of the binary
+			bindUniformBlocks(CachedProgramID);
+			return CachedProgramID;
+		}
+	}
+
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
@@ -88,6 +196,8 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
 	GLuint ProgramID = glCreateProgram();
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
+	if (UseCache)
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ProgramID);
 
 	// Check the program
@@ -99,13 +209,73 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
 		printf("%s\n", &ProgramErrorMessage[0]);
 	}
 
-
 	glDetachShader(ProgramID, VertexShaderID);
 	glDetachShader(ProgramID, FragmentShaderID);
 
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
+	if (Result != GL_TRUE) {
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+	if (UseCache)
+		storeCachedProgram(CachePath, ProgramID);
+
+	// shared per frame blocks live at fixed binding points
+	bindUniformBlocks(ProgramID);
+
+	return ProgramID;
+}
+
+GLuint LoadFeedbackShader(const char* vertex_file_path, const char* const* varyings, int varyingCount) {
+
+	std::string VertexShaderCode;
+	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
+	if (!VertexShaderStream.is_open()) {
+		printf("Impossible to open %s. Are you in the right directory ?\n", vertex_file_path);
+		return 0;
+	}
+	std::stringstream sstr;
+	sstr << VertexShaderStream.rdbuf();
+	VertexShaderCode = sstr.str();
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+
+	printf("Compiling shader : %s\n", vertex_file_path);
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	char const* VertexSourcePointer = VertexShaderCode.c_str();
+	glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
+	glCompileShader(VertexShaderID);
+	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength > 0) {
+		std::vector<char> VertexShaderErrorMessage(InfoLogLength + 1);
+		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
+		printf("%s\n", &VertexShaderErrorMessage[0]);
+	}
+
+	// The captured outputs are part of the link, they have to be named first
+	printf("Linking program\n");
+	GLuint ProgramID = glCreateProgram();
+	glAttachShader(ProgramID, VertexShaderID);
+	glTransformFeedbackVaryings(ProgramID, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(ProgramID);
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength > 0) {
+		std::vector<char> ProgramErrorMessage(InfoLogLength + 1);
+		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		printf("%s\n", &ProgramErrorMessage[0]);
+	}
+
+	glDetachShader(ProgramID, VertexShaderID);
+	glDeleteShader(VertexShaderID);
+	if (Result != GL_TRUE) {
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
 
+	bindUniformBlocks(ProgramID);
 	return ProgramID;
 }
 
@@ -0,0 +1,258 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+
+#include <GLM\\glm\\glm.hpp>
+
+#include "headers\\control.hpp"
+#include "headers\\spectrumbus.hpp"
+#include "headers\\netstream.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\simulation.hpp"
+
+// spectrum and band smoothing, seconds to close 63% of a step
+static const double ATTACK_SECONDS = 0.010;
+static const double RELEASE_SECONDS = 0.150;
+
+// the frame fields before the spectrum, copied as they are
+static const size_t HEADER_BYTES = offsetof(AnalysisFrame, spectrum);
+
+Simulation::Simulation()
+	: _rate(DEFAULT_RATE), _previous(0), _current(1), _hasLatest(false), _unreadBeats(0),
+	_keptCount(0), _takenCount(0), _bus(0), _receiver(0), _running(false), _start(std::chrono::steady_clock::now()),
+	_skipped(0)
+{
+	memset(&_pendingInput, 0, sizeof(_pendingInput));
+	Reset(DEFAULT_RATE, initialCamera());
+}
+
+Simulation::~Simulation()
+{
+	Stop();
+}
+
+void Simulation::Reset(double rate, CameraState const& camera)
+{
+	_rate = rate;
+	for (int i = 0; i < 3; i++) {
+		SimulationState& state = _states[i];
+		state.tick = 0;
+		state.time = 0;
+		state.camera = camera;
+		state.hasAudio = false;
+		memset(&state.audio, 0, sizeof(state.audio));
+	}
+	_previous = 0;
+	_current = 1;
+	_hasLatest = false;
+	_unreadBeats = 0;
+	_skipped = 0;
+}
+
+// only the ticking thread writes the states, so it may read them unlocked
+void Simulation::Step(ControlInput const& input, AnalysisFrame const* audio)
+{
+	TRACE_SCOPE("Simulation::Step");
+	if (audio != NULL) {
+		memcpy(&_latest, audio, sizeof(AnalysisFrame));
+		_hasLatest = true;
+	}
+
+	SimulationState const& current = _states[_current];
+	int nextIndex = 3 - _previous - _current;
+	SimulationState& next = _states[nextIndex];
+	float dt = (float)(1.0 / _rate);
+
+	next.tick = current.tick + 1;
+	next.time = next.tick / _rate;
+	next.camera = current.camera;
+	stepCamera(next.camera, input, dt);
+
+	next.hasAudio = _hasLatest;
+	if (_hasLatest) {
+		float attack = (float)(1.0 - exp(-1.0 / (_rate * ATTACK_SECONDS)));
+		float release = (float)(1.0 - exp(-1.0 / (_rate * RELEASE_SECONDS)));
+		AnalysisFrame const& from = current.audio;
+		AnalysisFrame& to = next.audio;
+		// header (sequence, beat flags, loudness...) straight from the newest frame
+		memcpy(&to, &_latest, HEADER_BYTES);
+		for (int i = 0; i < NUM_BANDS; i++) {
+			float target = _latest.bands[i];
+			to.bands[i] = from.bands[i] + (target - from.bands[i]) * (target > from.bands[i] ? attack : release);
+		}
+		uint32_t bins = _latest.binCount < MAX_BINS ? _latest.binCount : MAX_BINS;
+		for (uint32_t i = 0; i < bins; i++) {
+			float target = _latest.spectrum[i];
+			float value = from.spectrum[i];
+			to.spectrum[i] = value + (target - value) * (target > value ? attack : release);
+		}
+	}
+
+	std::lock_guard<std::mutex> hold(_stateLock);
+	if (audio != NULL)
+		_unreadBeats |= audio->beatFlags;
+	_previous = _current;
+	_current = nextIndex;
+}
+
+static float blend(float a, float b, float t) {
+	return a + (b - a) * t;
+}
+
+void Simulation::Interpolate(double seconds, SimulationState& out)
+{
+	std::lock_guard<std::mutex> hold(_stateLock);
+	SimulationState const& a = _states[_previous];
+	SimulationState const& b = _states[_current];
+	double span = b.time - a.time;
+	float t = span > 0 ? (float)((seconds - a.time) / span) : 1.0f;
+	t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+	out.tick = b.tick;
+	out.time = a.time + span * t;
+	out.camera = lerpCamera(a.camera, b.camera, t);
+	out.hasAudio = b.hasAudio;
+	if (!b.hasAudio)
+		return;
+	memcpy(&out.audio, &b.audio, HEADER_BYTES);
+	out.audio.beatFlags = _unreadBeats;
+	_unreadBeats = 0;
+	bool blendFrom = a.hasAudio && a.audio.binCount == b.audio.binCount;
+	for (int i = 0; i < NUM_BANDS; i++)
+		out.audio.bands[i] = blendFrom ? blend(a.audio.bands[i], b.audio.bands[i], t) : b.audio.bands[i];
+	uint32_t bins = b.audio.binCount < MAX_BINS ? b.audio.binCount : MAX_BINS;
+	for (uint32_t i = 0; i < bins; i++)
+		out.audio.spectrum[i] = blendFrom ? blend(a.audio.spectrum[i], b.audio.spectrum[i], t) : b.audio.spectrum[i];
+}
+
+void Simulation::Keep(AnalysisFrame const& frame)
+{
+	std::lock_guard<std::mutex> hold(_keptLock);
+	memcpy(&_kept[_keptCount % RECEIVED_FRAMES], &frame, sizeof(AnalysisFrame));
+	_keptCount++;
+}
+
+bool Simulation::TakeReceived(AnalysisFrame& out)
+{
+	std::lock_guard<std::mutex> hold(_keptLock);
+	// a renderer that fell behind gets the newest ones
+	if (_keptCount - _takenCount > RECEIVED_FRAMES)
+		_takenCount = _keptCount - RECEIVED_FRAMES;
+	if (_takenCount == _keptCount)
+		return false;
+	memcpy(&out, &_kept[_takenCount % RECEIVED_FRAMES], sizeof(AnalysisFrame));
+	_takenCount++;
+	return true;
+}
+
+uint64_t Simulation::Ticks() const
+{
+	std::lock_guard<std::mutex> hold(_stateLock);
+	return _states[_current].tick;
+}
+
+bool Simulation::Start(SpectrumBusReader* bus, SpectrumReceiver* receiver)
+{
+	if (_running)
+		return false;
+	_bus = bus;
+	_receiver = receiver;
+	_start = std::chrono::steady_clock::now();
+	_running = true;
+#ifdef _WIN32
+	// the default 15.6 ms timer would run the ticks in bursts
+	timeBeginPeriod(1);
+#endif
+	_thread = std::thread(&Simulation::ThreadLoop, this);
+	return true;
+}
+
+void Simulation::Stop()
+{
+	if (!_running)
+		return;
+	_running = false;
+	_thread.join();
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+double Simulation::Now() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+void Simulation::PushInput(ControlInput const& input)
+{
+	std::lock_guard<std::mutex> hold(_inputLock);
+	_pendingInput.mouseX += input.mouseX;
+	_pendingInput.mouseY += input.mouseY;
+	_pendingInput.forward = input.forward;
+	_pendingInput.backward = input.backward;
+	_pendingInput.right = input.right;
+	_pendingInput.left = input.left;
+}
+
+void Simulation::ThreadLoop()
+{
+	TRACE_THREAD_NAME("simulation");
+	uint64_t tick = _states[_current].tick;
+	std::chrono::duration<double> period(1.0 / _rate);
+
+	while (_running) {
+		// tick n is due at n / rate on the simulation clock
+		std::chrono::steady_clock::time_point due = _start +
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * (double)(tick + 1));
+		std::this_thread::sleep_until(due);
+
+		uint64_t behind = (uint64_t)(Now() * _rate) - tick;
+		if (behind > MAX_CATCH_UP) {
+			// a stall this long can't be caught up, skip ahead instead
+			_skipped += behind - 1;
+			std::lock_guard<std::mutex> hold(_stateLock);
+			_states[_current].tick += behind - 1;
+			_states[_current].time = _states[_current].tick / _rate;
+			behind = 1;
+		}
+
+		for (uint64_t i = 0; i < behind; i++) {
+			AnalysisFrame const* audio = NULL;
+			// the tick steps with the newest frame, carrying the beats of all of them
+			uint32_t beats = 0;
+			if (_bus != NULL) {
+				if (_bus->Read(_received)) {
+					Keep(_received);
+					beats |= _received.beatFlags;
+					audio = &_received;
+				}
+			}
+			if (_receiver != NULL) {
+				uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+				_receiver->Poll(now);
+				while (_receiver->Next(now, _received)) {
+					Keep(_received);
+					beats |= _received.beatFlags;
+					audio = &_received;
+				}
+			}
+			if (audio != NULL)
+				_received.beatFlags = beats;
+
+			ControlInput input;
+			{
+				std::lock_guard<std::mutex> hold(_inputLock);
+				input = _pendingInput;
+				_pendingInput.mouseX = 0;
+				_pendingInput.mouseY = 0;
+			}
+			Step(input, audio);
+		}
+		tick = _states[_current].tick;
+	}
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+#include <GL\\glew.h>
+
+#include "headers\\shader.hpp"
+#include "headers\\spectrogram.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\trace.hpp"
+
+// same scale as the bars: this many dB above the floor fill the palette
+static const float ROW_FLOOR_DB = 20.0f;
+static const float ROW_RANGE_DB = 100.0f;
+
+Spectrogram::Spectrogram()
+	: _program(0), _vao(0), _texture(0), _rectID(-1), _newestID(-1), _historyID(-1),
+	_rowCount(0), _columns(0), _newest(0), _lastSequence(0), _edgeBins(0), _any(false)
+{
+}
+
+Spectrogram::~Spectrogram()
+{
+	glDeleteTextures(1, &_texture);
+	glDeleteVertexArrays(1, &_vao);
+	glDeleteProgram(_program);
+}
+
+bool Spectrogram::Init(int rows, int columns, const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	GLuint program = LoadShaders(vertexShaderPath, fragmentShaderPath);
+	if (program == 0)
+		return false;
+	SetProgram(program);
+	_rowCount = rows;
+	_columns = columns;
+	_edges.resize(columns + 1);
+	// the first row written lands in row 0
+	_newest = rows - 1;
+
+	if (!_rows.Init(GL_PIXEL_UNPACK_BUFFER, columns))
+		return false;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// history starts silent
+	std::vector<unsigned char> silence(rows * columns, 0);
+	glGenTextures(1, &_texture);
+	glState().BindTexture(0, _texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, columns, rows, 0, GL_RED, GL_UNSIGNED_BYTE, &silence[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// nearest across rows so the newest row never blends with the oldest at the seam
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	// the panel quad comes from gl_VertexID, the VAO is only there for core profile
+	glGenVertexArrays(1, &_vao);
+	return glGetError() == GL_NO_ERROR;
+}
+
+void Spectrogram::SetProgram(GLuint program)
+{
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+	_program = program;
+	_rectID = glGetUniformLocation(_program, "rect");
+	_newestID = glGetUniformLocation(_program, "newestRow");
+	_historyID = glGetUniformLocation(_program, "rowCount");
+}
+
+void Spectrogram::Update(AnalysisFrame const& frame)
+{
+	TRACE_SCOPE("Spectrogram::Update");
+	if (frame.binCount < 2 || (_any && frame.sequence == _lastSequence))
+		return;
+	unsigned char* row = (unsigned char*)_rows.Map(_columns);
+	if (row == 0)
+		return;
+	_any = true;
+	_lastSequence = frame.sequence;
+
+	// column c covers bins [r^c, r^(c+1)), at least one bin wide; loudest wins
+	if (frame.binCount != _edgeBins) {
+		_edgeBins = frame.binCount;
+		double ratio = pow((double)frame.binCount, 1.0 / _columns);
+		double edge = 1.0;
+		for (int c = 0; c <= _columns; c++, edge *= ratio)
+			_edges[c] = (int)edge;
+	}
+	for (int c = 0; c < _columns; c++) {
+		int lo = _edges[c] < (int)frame.binCount - 1 ? _edges[c] : frame.binCount - 1;
+		int hi = _edges[c + 1] > lo ? _edges[c + 1] : lo + 1;
+		if (hi > (int)frame.binCount)
+			hi = frame.binCount;
+		float mag = 0.0f;
+		for (int b = lo; b < hi; b++)
+			if (frame.spectrum[b] > mag)
+				mag = frame.spectrum[b];
+		float db = mag > 0.0f ? 20.0f * log10f(mag) : 0.0f;
+		float level = (db - ROW_FLOOR_DB) / ROW_RANGE_DB;
+		level = level < 0.0f ? 0.0f : (level > 1.0f ? 1.0f : level);
+		row[c] = (unsigned char)(level * 255.0f);
+	}
+	size_t offset = _rows.Unmap();
+
+	_newest = (_newest + 1) % _rowCount;
+	glState().BindTexture(0, _texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, _newest, _columns, 1, GL_RED, GL_UNSIGNED_BYTE, (void*)offset);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	// the copy out of the unpack buffer is what the fence has to cover
+	_rows.Fence();
+}
+
+void Spectrogram::Draw(float left, float bottom, float right, float top)
+{
+	TRACE_SCOPE("Spectrogram::Draw");
+	if (!_any)
+		return;
+	glState().UseProgram(_program);
+	glState().Uniform4f(_rectID, left, bottom, right, top);
+	glState().Uniform1i(_newestID, _newest);
+	glState().Uniform1i(_historyID, _rowCount);
+	glState().BindTexture(0, _texture);
+	glState().BindVertexArray(_vao);
+	glState().Set(RenderState::DEPTH_TEST, false);
+	glState().Set(RenderState::BLEND, false);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
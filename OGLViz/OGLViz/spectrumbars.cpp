@@ -0,0 +1,191 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <GL\\glew.h>
+
+#include "headers\\shader.hpp"
+#include "headers\\spectrumbars.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\trace.hpp"
+
+// bar heights span this many dB above the floor
+static const float BAR_FLOOR_DB = 20.0f;
+static const float BAR_RANGE_DB = 100.0f;
+
+SpectrumBars::SpectrumBars()
+	: _program(0), _vao(0), _meshBuffer(0),
+	_barCountID(-1), _textureProgram(0), _textureVao(0), _textureBarCountID(-1), _binCountID(-1),
+	_spectrum(0), _binCount(0), _maxBars(0), _barCount(0), _streamedCount(0)
+{
+}
+
+SpectrumBars::~SpectrumBars()
+{
+	glDeleteBuffers(1, &_meshBuffer);
+	glDeleteVertexArrays(1, &_vao);
+	glDeleteVertexArrays(1, &_textureVao);
+	glDeleteProgram(_program);
+	glState().ForgetProgram(_textureProgram);
+	glDeleteProgram(_textureProgram);
+}
+
+bool SpectrumBars::Init(int maxBars, const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	GLuint program = LoadShaders(vertexShaderPath, fragmentShaderPath);
+	if (program == 0)
+		return false;
+	SetProgram(program);
+	_maxBars = maxBars;
+
+	// unit bar as a triangle strip
+	static const GLfloat corners[] = {
+		0.0f, 0.0f,
+		1.0f, 0.0f,
+		0.0f, 1.0f,
+		1.0f, 1.0f,
+	};
+
+	glGenVertexArrays(1, &_vao);
+	glState().BindVertexArray(_vao);
+
+	glGenBuffers(1, &_meshBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, _meshBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	// instance attributes are pointed at this frame's region in Update
+	if (!_stream.Init(GL_ARRAY_BUFFER, maxBars * sizeof(BarInstance)))
+		return false;
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+	return true;
+}
+
+void SpectrumBars::SetProgram(GLuint program)
+{
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+	_program = program;
+	_barCountID = glGetUniformLocation(_program, "barCount");
+}
+
+bool SpectrumBars::InitTextureSource(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	GLuint program = LoadShaders(vertexShaderPath, fragmentShaderPath);
+	if (program == 0)
+		return false;
+	SetTextureProgram(program);
+	glGenVertexArrays(1, &_textureVao);
+	glState().BindVertexArray(_textureVao);
+	glBindBuffer(GL_ARRAY_BUFFER, _meshBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	return true;
+}
+
+void SpectrumBars::SetTextureProgram(GLuint program)
+{
+	glState().ForgetProgram(_textureProgram);
+	glDeleteProgram(_textureProgram);
+	_textureProgram = program;
+	_textureBarCountID = glGetUniformLocation(_textureProgram, "barCount");
+	_binCountID = glGetUniformLocation(_textureProgram, "binCount");
+	glState().UseProgram(_textureProgram);
+	glState().Uniform1i(glGetUniformLocation(_textureProgram, "spectrum"), 0);
+}
+
+void SpectrumBars::UpdateFromTexture(GLuint spectrum, int binCount, int barCount)
+{
+	_spectrum = spectrum;
+	_binCount = binCount;
+	_barCount = barCount > _maxBars ? _maxBars : barCount;
+	if (binCount < 2)
+		_barCount = 0;
+}
+
+void SpectrumBars::Update(AnalysisFrame const& frame, int barCount)
+{
+	TRACE_SCOPE("SpectrumBars::Update");
+	_spectrum = 0;
+	if (barCount > _maxBars)
+		barCount = _maxBars;
+	_barCount = barCount;
+	if (frame.binCount < 2 || barCount <= 0) {
+		_barCount = 0;
+		return;
+	}
+	BarInstance* instances = (BarInstance*)_stream.Map(barCount * sizeof(BarInstance));
+	if (instances == 0) {
+		// the GPU still reads the next region: draw last frame's bars again
+		_barCount = _streamedCount;
+		return;
+	}
+
+	// bar i covers bins [1 * r^i, 1 * r^(i+1)), r spreading the bars up to the last bin
+	double ratio = pow((double)frame.binCount, 1.0 / barCount);
+	double edge = 1.0;
+	for (int i = 0; i < barCount; i++) {
+		int lo = (int)edge;
+		edge *= ratio;
+		int hi = (int)edge;
+		if (hi <= lo)
+			hi = lo + 1;
+		if (hi > (int)frame.binCount)
+			hi = frame.binCount;
+		float mag = 0.0f;
+		for (int b = lo; b < hi; b++)
+			if (frame.spectrum[b] > mag)
+				mag = frame.spectrum[b];
+
+		float db = mag > 0.0f ? 20.0f * log10f(mag) : 0.0f;
+		float h = (db - BAR_FLOOR_DB) / BAR_RANGE_DB;
+		h = h < 0.0f ? 0.0f : (h > 1.0f ? 1.0f : h);
+
+		// blue at the bass end to red at the top, brighter when louder
+		float t = (float)i / barCount;
+		float bright = 0.4f + 0.6f * h;
+		BarInstance& bar = instances[i];
+		bar.height = h;
+		bar.color[0] = (unsigned char)(255.0f * bright * t);
+		bar.color[1] = (unsigned char)(255.0f * bright * (1.0f - fabsf(2.0f * t - 1.0f)));
+		bar.color[2] = (unsigned char)(255.0f * bright * (1.0f - t));
+		bar.color[3] = 255;
+	}
+
+	size_t offset = _stream.Unmap();
+	_streamedCount = barCount;
+	glState().BindVertexArray(_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, _stream.Buffer());
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(BarInstance), (void*)offset);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BarInstance), (void*)(offset + offsetof(BarInstance, color)));
+}
+
+void SpectrumBars::Draw()
+{
+	TRACE_SCOPE("SpectrumBars::Draw");
+	if (_barCount <= 0)
+		return;
+	if (_spectrum != 0) {
+		glState().UseProgram(_textureProgram);
+		glState().Uniform1i(_textureBarCountID, _barCount);
+		glState().Uniform1i(_binCountID, _binCount);
+		glState().BindTexture(0, _spectrum);
+		glState().BindVertexArray(_textureVao);
+		glState().Set(RenderState::DEPTH_TEST, false);
+		glState().Set(RenderState::BLEND, false);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, _barCount);
+		return;
+	}
+	glState().UseProgram(_program);
+	glState().Uniform1i(_barCountID, _barCount);
+	glState().BindVertexArray(_vao);
+	// 2D overlay on top of the scene
+	glState().Set(RenderState::DEPTH_TEST, false);
+	glState().Set(RenderState::BLEND, false);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, _barCount);
+	_stream.Fence();
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "headers/spectrumbus.hpp"
+
+static const uint32_t BUS_MAGIC = 0x53504255; // "SPBU"
+static const uint32_t BUS_VERSION = 2;
+
+bool SharedMapping::Open(const char* name, size_t size, bool create)
+{
+	Close();
+	_owner = create;
+	snprintf(_name, sizeof _name, "%s", name);
+#ifdef _WIN32
+	HANDLE h;
+	if (create)
+		h = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size, name);
+	else
+		h = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	if (h == NULL) {
+		fprintf(stderr, "Cannot open shared memory '%s' (error %lu)\n", name, GetLastError());
+		return false;
+	}
+	_base = MapViewOfFile(h, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size);
+	if (_base == NULL) {
+		fprintf(stderr, "Cannot map shared memory '%s' (error %lu)\n", name, GetLastError());
+		CloseHandle(h);
+		return false;
+	}
+	_handle = h;
+#else
+	// POSIX wants a leading slash
+	char path[72];
+	snprintf(path, sizeof path, name[0] == '/' ? "%s" : "/%s", name);
+	int fd = create ? shm_open(path, O_CREAT | O_RDWR, 0644) : shm_open(path, O_RDONLY, 0);
+	if (fd < 0) {
+		perror("shm_open");
+		return false;
+	}
+	if (create && ftruncate(fd, (off_t)size) != 0) {
+		perror("ftruncate");
+		close(fd);
+		return false;
+	}
+	void* p = mmap(NULL, size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		return false;
+	}
+	_base = p;
+	snprintf(_name, sizeof _name, "%s", path);
+#endif
+	_size = size;
+	return true;
+}
+
+void SharedMapping::Close()
+{
+	if (_base == 0)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(_base);
+	CloseHandle((HANDLE)_handle);
+#else
+	munmap(_base, _size);
+	if (_owner)
+		shm_unlink(_name);
+#endif
+	_base = 0;
+	_handle = 0;
+}
+
+bool SpectrumBusWriter::Create(const char* name)
+{
+	if (!_map.Open(name, sizeof(SpectrumBusHeader), true))
+		return false;
+	_bus = (SpectrumBusHeader*)_map.Base();
+	// readers check magic last, so a half initialised segment is never accepted
+	_bus->magic = 0;
+	std::atomic_thread_fence(std::memory_order_release);
+	_bus->version = BUS_VERSION;
+	_bus->slotCount = BUS_SLOTS;
+	_bus->frameSize = sizeof(AnalysisFrame);
+	_bus->published.store(0, std::memory_order_relaxed);
+	for (int i = 0; i < BUS_SLOTS; i++)
+		_bus->slots[i].seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	_bus->magic = BUS_MAGIC;
+	return true;
+}
+
+AnalysisFrame& SpectrumBusWriter::Begin()
+{
+	uint64_t n = _bus->published.load(std::memory_order_relaxed);
+	SpectrumBusSlot& slot = _bus->slots[n % BUS_SLOTS];
+	slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	return slot.frame;
+}
+
+void SpectrumBusWriter::Commit()
+{
+	uint64_t n = _bus->published.load(std::memory_order_relaxed);
+	_bus->slots[n % BUS_SLOTS].seq.store(2 * n + 2, std::memory_order_release);
+	_bus->published.store(n + 1, std::memory_order_release);
+}
+
+void SpectrumBusWriter::Publish(AnalysisFrame const& frame)
+{
+	AnalysisFrame& dst = Begin();
+	// only the valid part of the spectrum
+	memcpy(&dst, &frame, sizeof(AnalysisFrame) - sizeof(frame.spectrum) + frame.binCount * sizeof(float));
+	Commit();
+}
+
+bool SpectrumBusReader::Attach(const char* name)
+{
+	if (!_map.Open(name, sizeof(SpectrumBusHeader), false))
+		return false;
+	_bus = (SpectrumBusHeader*)_map.Base();
+	if (_bus->magic != BUS_MAGIC || _bus->version != BUS_VERSION ||
+		_bus->slotCount != BUS_SLOTS || _bus->frameSize != sizeof(AnalysisFrame)) {
+		fprintf(stderr, "Spectrum bus '%s' has an incompatible layout\n", name);
+		_map.Close();
+		_bus = 0;
+		return false;
+	}
+	_lastSeen = _bus->published.load(std::memory_order_acquire);
+	return true;
+}
+
+bool SpectrumBusReader::Read(AnalysisFrame& out)
+{
+	uint64_t published = _bus->published.load(std::memory_order_acquire);
+	if (published == _lastSeen)
+		return false;
+	uint64_t n = published - 1;
+	SpectrumBusSlot const& slot = _bus->slots[n % BUS_SLOTS];
+	if (slot.seq.load(std::memory_order_acquire) != 2 * n + 2)
+		return false; // lapped while we looked, try again next frame
+	memcpy(&out, &slot.frame, sizeof(AnalysisFrame));
+	// the copy is only whole if the writer did not start on the slot meanwhile
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (slot.seq.load(std::memory_order_relaxed) != 2 * n + 2)
+		return false;
+	_dropped += published - _lastSeen - 1;
+	_lastSeen = published;
+	return true;
+}
@@ -0,0 +1,135 @@
+#include <math.h>
+#include <string.h>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "headers\\stereo.hpp"
+#include "headers\\trace.hpp"
+
+void VectorscopeRing::Push(const float* points, int count)
+{
+	unsigned long long n = _written.load(std::memory_order_relaxed);
+	int start = (int)(n & (CAPACITY - 1));
+	int firstCount = CAPACITY - start < count ? CAPACITY - start : count;
+	memcpy(&_points[2 * start], points, 2 * firstCount * sizeof(float));
+	memcpy(&_points[0], points + 2 * firstCount, 2 * (count - firstCount) * sizeof(float));
+	_written.store(n + count, std::memory_order_release);
+}
+
+int VectorscopeRing::Newest(int count, const float*& first, int& firstCount, const float*& second, int& secondCount) const
+{
+	unsigned long long written = _written.load(std::memory_order_acquire);
+	if ((unsigned long long)count > written)
+		count = (int)written;
+	if (count > CAPACITY)
+		count = CAPACITY;
+	int start = (int)((written - count) & (CAPACITY - 1));
+	firstCount = CAPACITY - start < count ? CAPACITY - start : count;
+	secondCount = count - firstCount;
+	first = &_points[2 * start];
+	second = &_points[0];
+	return count;
+}
+
+StereoAnalyzer::StereoAnalyzer(float smoothing)
+	: _smoothing(smoothing), _ll(0.0f), _rr(0.0f), _lr(0.0f)
+{
+}
+
+void StereoAnalyzer::Process(const float* left, const float* right, int count, AnalysisFrame& frame)
+{
+	TRACE_SCOPE("StereoAnalyzer::Process");
+	float ll = 0.0f, rr = 0.0f, lr = 0.0f;
+	int i = 0;
+#if defined(_M_X64) || defined(__SSE2__)
+	__m128 vll = _mm_setzero_ps();
+	__m128 vrr = _mm_setzero_ps();
+	__m128 vlr = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		__m128 l = _mm_loadu_ps(left + i);
+		__m128 r = _mm_loadu_ps(right + i);
+		vll = _mm_add_ps(vll, _mm_mul_ps(l, l));
+		vrr = _mm_add_ps(vrr, _mm_mul_ps(r, r));
+		vlr = _mm_add_ps(vlr, _mm_mul_ps(l, r));
+	}
+	float sums[3][4];
+	_mm_storeu_ps(sums[0], vll);
+	_mm_storeu_ps(sums[1], vrr);
+	_mm_storeu_ps(sums[2], vlr);
+	ll = sums[0][0] + sums[0][1] + sums[0][2] + sums[0][3];
+	rr = sums[1][0] + sums[1][1] + sums[1][2] + sums[1][3];
+	lr = sums[2][0] + sums[2][1] + sums[2][2] + sums[2][3];
+#endif
+	for (; i < count; i++) {
+		ll += left[i] * left[i];
+		rr += right[i] * right[i];
+		lr += left[i] * right[i];
+	}
+	if (count > 0) {
+		ll /= count;
+		rr /= count;
+		lr /= count;
+	}
+
+	_ll = _smoothing * _ll + (1.0f - _smoothing) * ll;
+	_rr = _smoothing * _rr + (1.0f - _smoothing) * rr;
+	_lr = _smoothing * _lr + (1.0f - _smoothing) * lr;
+
+	// silence reads as mono and centred rather than NaN
+	float power = _ll * _rr;
+	frame.correlation = power > 1e-12f ? _lr / sqrtf(power) : 1.0f;
+	frame.balance = _ll + _rr > 1e-12f ? (_rr - _ll) / (_rr + _ll) : 0.0f;
+	// M = (L+R)/2, S = (L-R)/2
+	frame.midEnergy = 0.25f * (_ll + _rr + 2.0f * _lr);
+	frame.sideEnergy = 0.25f * (_ll + _rr - 2.0f * _lr);
+
+	Decimate(left, right, count);
+	const float* first;
+	const float* second;
+	int firstCount, secondCount;
+	frame.scopeCount = _scope.Newest(SCOPE_POINTS, first, firstCount, second, secondCount);
+	memcpy(frame.scopePoints, first, 2 * firstCount * sizeof(float));
+	memcpy(frame.scopePoints + 2 * firstCount, second, 2 * secondCount * sizeof(float));
+}
+
+// every DECIMATION-th sample as a (side, mid) point, into the ring
+void StereoAnalyzer::Decimate(const float* left, const float* right, int count)
+{
+	const int BLOCK = 256;      // points per push
+	float points[2 * BLOCK];
+	const float k = 0.70710678f;
+	int n = 0;
+	int j = 0;
+#if defined(_M_X64) || defined(__SSE2__)
+	// four points from 16 samples: lane 0 of four loads, then S/M and interleave
+	__m128 vk = _mm_set1_ps(k);
+	for (; j + 4 * DECIMATION <= count; j += 4 * DECIMATION) {
+		__m128 l = _mm_movelh_ps(
+			_mm_unpacklo_ps(_mm_loadu_ps(left + j), _mm_loadu_ps(left + j + DECIMATION)),
+			_mm_unpacklo_ps(_mm_loadu_ps(left + j + 2 * DECIMATION), _mm_loadu_ps(left + j + 3 * DECIMATION)));
+		__m128 r = _mm_movelh_ps(
+			_mm_unpacklo_ps(_mm_loadu_ps(right + j), _mm_loadu_ps(right + j + DECIMATION)),
+			_mm_unpacklo_ps(_mm_loadu_ps(right + j + 2 * DECIMATION), _mm_loadu_ps(right + j + 3 * DECIMATION)));
+		__m128 side = _mm_mul_ps(vk, _mm_sub_ps(r, l));
+		__m128 mid = _mm_mul_ps(vk, _mm_add_ps(l, r));
+		_mm_storeu_ps(&points[2 * n], _mm_unpacklo_ps(side, mid));
+		_mm_storeu_ps(&points[2 * n + 4], _mm_unpackhi_ps(side, mid));
+		n += 4;
+		if (n == BLOCK) {
+			_scope.Push(points, n);
+			n = 0;
+		}
+	}
+#endif
+	for (; j < count; j += DECIMATION) {
+		points[2 * n] = k * (right[j] - left[j]);
+		points[2 * n + 1] = k * (left[j] + right[j]);
+		if (++n == BLOCK) {
+			_scope.Push(points, n);
+			n = 0;
+		}
+	}
+	if (n > 0)
+		_scope.Push(points, n);
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+
+#include <GL\\glew.h>
+
+#include "headers\\streambuffer.hpp"
+
+StreamBuffer::StreamBuffer()
+	: _target(GL_ARRAY_BUFFER), _buffer(0), _regionSize(0), _region(0), _last(0),
+	_persistent(0), _skips(0), _orphans(0)
+{
+	for (int i = 0; i < REGIONS; i++)
+		_fences[i] = 0;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for (int i = 0; i < REGIONS; i++)
+		if (_fences[i] != 0)
+			glDeleteSync(_fences[i]);
+	if (_persistent != 0) {
+		glBindBuffer(_target, _buffer);
+		glUnmapBuffer(_target);
+	}
+	glDeleteBuffers(1, &_buffer);
+}
+
+bool StreamBuffer::Init(GLenum target, size_t regionSize, size_t alignment, bool allowPersistent)
+{
+	_target = target;
+	_regionSize = (regionSize + alignment - 1) / alignment * alignment;
+	GLsizeiptr total = (GLsizeiptr)(_regionSize * REGIONS);
+
+	glGenBuffers(1, &_buffer);
+	if (_buffer == 0)
+		return false;
+	glBindBuffer(_target, _buffer);
+	if (allowPersistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(_target, total, NULL, flags);
+		_persistent = (char*)glMapBufferRange(_target, 0, total, flags);
+		if (_persistent == 0) {
+			// immutable storage can't be respecified, start over with a new name
+			fprintf(stderr, "Persistent mapping failed, streaming through glMapBufferRange\n");
+			glDeleteBuffers(1, &_buffer);
+			glGenBuffers(1, &_buffer);
+			glBindBuffer(_target, _buffer);
+		}
+	}
+	if (_persistent == 0)
+		glBufferData(_target, total, NULL, GL_STREAM_DRAW);
+	// ask the buffer itself rather than glGetError, which may hold someone else's error
+	GLint size = 0;
+	glGetBufferParameteriv(_target, GL_BUFFER_SIZE, &size);
+	if (size != total) {
+		fprintf(stderr, "Could not allocate a %lld byte stream buffer\n", (long long)total);
+		return false;
+	}
+	return true;
+}
+
+// make sure the GPU is done with the region we are about to write; false
+// when it is not and the region can't be replaced (persistent storage)
+bool StreamBuffer::WaitRegion()
+{
+	GLsync fence = _fences[_region];
+	if (fence == 0)
+		return true;
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+		_fences[_region] = 0;
+		glDeleteSync(fence);
+		return true;
+	}
+	if (_persistent != 0) {
+		// immutable storage can't be orphaned and waiting would stall the CPU:
+		// keep the fence, skip this upload and let the last region stand in
+		_skips++;
+		glFlush();
+		return false;
+	}
+	else {
+		// hand the old storage to the driver, the GPU keeps reading it
+		_orphans++;
+		glBufferData(_target, (GLsizeiptr)(_regionSize * REGIONS), NULL, GL_STREAM_DRAW);
+		for (int i = 0; i < REGIONS; i++)
+			if (_fences[i] != 0) {
+				glDeleteSync(_fences[i]);
+				_fences[i] = 0;
+			}
+	}
+	return true;
+}
+
+void* StreamBuffer::Map(size_t size)
+{
+	if (size > _regionSize)
+		return 0;
+	glBindBuffer(_target, _buffer);
+	if (!WaitRegion())
+		return 0;
+	if (_persistent != 0)
+		return _persistent + _region * _regionSize;
+	return glMapBufferRange(_target, (GLintptr)(_region * _regionSize), (GLsizeiptr)size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+size_t StreamBuffer::Unmap()
+{
+	if (_persistent == 0) {
+		glBindBuffer(_target, _buffer);
+		glUnmapBuffer(_target);
+	}
+	_last = _region;
+	_region = (_region + 1) % REGIONS;
+	return _last * _regionSize;
+}
+
+// a newer fence covers everything the older one did, so drawing the same
+// region again just moves its fence forward
+void StreamBuffer::Fence()
+{
+	if (_fences[_last] != 0)
+		glDeleteSync(_fences[_last]);
+	_fences[_last] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,180 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "headers\\trace.hpp"
+
+#if OGLVIZ_TRACE
+
+std::atomic<bool> traceActive(false);
+
+// an instant event is stored with this duration
+static const uint64_t INSTANT = ~0ull;
+
+struct TraceEvent
+{
+	const char* name;
+	uint64_t    start;
+	uint64_t    duration;
+};
+
+struct TraceBuffer
+{
+	enum { CAPACITY = 1 << 18 };   // events, power of two
+
+	int                      tid;
+	std::atomic<const char*> threadName;
+	std::atomic<uint64_t>    count;       // events ever appended, the newest CAPACITY are kept
+	TraceEvent               events[CAPACITY];
+};
+
+// buffers are never freed, a thread that exited still shows up in the dump
+static std::mutex registryLock;
+static std::vector<TraceBuffer*> registry;
+static thread_local TraceBuffer* localBuffer = NULL;
+// named before its first event, kept here so naming allocates nothing
+static thread_local const char* localName = NULL;
+
+static TraceBuffer* threadBuffer()
+{
+	if (localBuffer == NULL) {
+		TraceBuffer* buffer = new TraceBuffer;
+		buffer->threadName.store(localName, std::memory_order_relaxed);
+		buffer->count.store(0, std::memory_order_relaxed);
+		std::lock_guard<std::mutex> hold(registryLock);
+		buffer->tid = (int)registry.size() + 1;
+		registry.push_back(buffer);
+		localBuffer = buffer;
+	}
+	return localBuffer;
+}
+
+static void append(const char* name, uint64_t start, uint64_t duration)
+{
+	TraceBuffer* buffer = threadBuffer();
+	uint64_t n = buffer->count.load(std::memory_order_relaxed);
+	// the previous count is out before this event's slot is touched (free on x86)
+	std::atomic_thread_fence(std::memory_order_release);
+	TraceEvent& event = buffer->events[n & (TraceBuffer::CAPACITY - 1)];
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+	// the writer only trusts events below count that were not lapped while it read them
+	buffer->count.store(n + 1, std::memory_order_release);
+}
+
+uint64_t traceNow()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void traceComplete(const char* name, uint64_t startNs, uint64_t endNs)
+{
+	append(name, startNs, endNs - startNs);
+}
+
+void traceInstant(const char* name)
+{
+	append(name, traceNow(), INSTANT);
+}
+
+void traceThreadName(const char* name)
+{
+	localName = name;
+	if (localBuffer != NULL)
+		localBuffer->threadName.store(name, std::memory_order_relaxed);
+}
+
+bool traceStart()
+{
+	traceActive.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+static unsigned long processId()
+{
+#ifdef _WIN32
+	return (unsigned long)GetCurrentProcessId();
+#else
+	return (unsigned long)getpid();
+#endif
+}
+
+bool traceWrite(const char* path)
+{
+	FILE* file = NULL;
+	if (fopen_s(&file, path, "w") != 0 || file == NULL) {
+		fprintf(stderr, "Cannot write trace %s\n", path);
+		return false;
+	}
+	std::vector<TraceBuffer*> buffers;
+	{
+		std::lock_guard<std::mutex> hold(registryLock);
+		buffers = registry;
+	}
+
+	unsigned long pid = processId();
+	unsigned long long written = 0, overwritten = 0;
+	std::vector<TraceEvent> events;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%lu,\"args\":{\"name\":\"OGLViz %lu\"}}", pid, pid);
+	for (size_t b = 0; b < buffers.size(); b++) {
+		TraceBuffer const* buffer = buffers[b];
+		const char* threadName = buffer->threadName.load(std::memory_order_relaxed);
+		if (threadName != NULL)
+			fprintf(file, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%lu,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				pid, buffer->tid, threadName);
+		// copy the newest events out, then drop any the thread overwrote meanwhile
+		uint64_t end = buffer->count.load(std::memory_order_acquire);
+		uint64_t first = end > TraceBuffer::CAPACITY ? end - TraceBuffer::CAPACITY : 0;
+		events.resize((size_t)(end - first));
+		for (uint64_t i = first; i < end; i++)
+			events[(size_t)(i - first)] = buffer->events[i & (TraceBuffer::CAPACITY - 1)];
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t now = buffer->count.load(std::memory_order_relaxed);
+		// the slot of event now - CAPACITY may be half rewritten by an append in progress
+		uint64_t valid = now >= TraceBuffer::CAPACITY ? now - TraceBuffer::CAPACITY + 1 : 0;
+		uint64_t kept = first > valid ? first : valid;
+		for (uint64_t i = kept; i < end; i++) {
+			TraceEvent const& event = events[(size_t)(i - first)];
+			// microseconds, the unit of the format
+			if (event.duration == INSTANT)
+				fprintf(file, ",\n{\"ph\":\"i\",\"s\":\"t\",\"name\":\"%s\",\"pid\":%lu,\"tid\":%d,\"ts\":%.3f}",
+					event.name, pid, buffer->tid, event.start / 1000.0);
+			else
+				fprintf(file, ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":%lu,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					event.name, pid, buffer->tid, event.start / 1000.0, event.duration / 1000.0);
+		}
+		written += end - kept;
+		overwritten += kept;
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	printf("Trace: %llu events written to %s", written, path);
+	if (overwritten > 0)
+		printf(", %llu older ones overwritten", overwritten);
+	printf("\n");
+	return true;
+}
+
+#else
+
+bool traceStart()
+{
+	fprintf(stderr, "Built without tracing (OGLVIZ_TRACE=0)\n");
+	return false;
+}
+
+bool traceWrite(const char*)
+{
+	return false;
+}
+
+#endif
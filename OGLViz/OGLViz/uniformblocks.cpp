@@ -0,0 +1,76 @@
+#include <string.h>
+#include <math.h>
+
+#include <GL\\glew.h>
+#include <GLM\\glm\\glm.hpp>
+
+#include "headers\\uniformblocks.hpp"
+#include "headers\\trace.hpp"
+
+// beat pulse falls to 1/e in this many seconds
+static const double BEAT_DECAY_SECONDS = 0.15;
+// band levels use the spectrum bars' scale
+static const float BAND_FLOOR_DB = 20.0f;
+static const float BAND_RANGE_DB = 100.0f;
+
+void bindUniformBlocks(GLuint program)
+{
+	GLuint frameIndex = glGetUniformBlockIndex(program, "FrameBlock");
+	if (frameIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, frameIndex, FRAME_BINDING);
+	GLuint audioIndex = glGetUniformBlockIndex(program, "AudioBlock");
+	if (audioIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, audioIndex, AUDIO_BINDING);
+}
+
+UniformBlocks::UniformBlocks()
+	: _audioOffset(0), _lastSequence(0), _anySequence(false), _lastBeat(-1000.0)
+{
+	memset(&_audio, 0, sizeof(_audio));
+	_audio.momentaryLufs = _audio.shortTermLufs = -70.0f;
+	_audio.rmsDb = _audio.peakDb = -100.0f;
+	_audio.secondsSinceBeat = 1000.0f;
+}
+
+bool UniformBlocks::Init()
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	_audioOffset = (sizeof(FrameUniforms) + alignment - 1) / alignment * alignment;
+	return _stream.Init(GL_UNIFORM_BUFFER, _audioOffset + sizeof(AudioUniforms), alignment);
+}
+
+void UniformBlocks::Update(FrameUniforms const& frame, AnalysisFrame const* audio, double seconds)
+{
+	TRACE_SCOPE("UniformBlocks::Update");
+	if (audio != NULL) {
+		// smoothed bands move between analysis frames, levels follow every frame
+		for (int i = 0; i < NUM_BANDS; i++) {
+			float db = audio->bands[i] > 0.0f ? 10.0f * log10f(audio->bands[i]) : 0.0f;
+			float level = (db - BAND_FLOOR_DB) / BAND_RANGE_DB;
+			_audio.bands[i / 4][i % 4] = level < 0.0f ? 0.0f : (level > 1.0f ? 1.0f : level);
+		}
+		// a beat belongs to one analysis frame, however often it is drawn
+		if ((!_anySequence || audio->sequence != _lastSequence) && (audio->beatFlags & BEAT_ANY))
+			_lastBeat = seconds;
+		_lastSequence = audio->sequence;
+		_anySequence = true;
+		_audio.momentaryLufs = audio->momentaryLufs;
+		_audio.shortTermLufs = audio->shortTermLufs;
+		_audio.rmsDb = audio->rmsDb;
+		_audio.peakDb = audio->peakDb;
+		_audio.correlation = audio->correlation;
+		_audio.balance = audio->balance;
+	}
+	_audio.secondsSinceBeat = (float)(seconds - _lastBeat);
+	_audio.beatPulse = (float)exp(-(seconds - _lastBeat) / BEAT_DECAY_SECONDS);
+
+	char* dst = (char*)_stream.Map(_audioOffset + sizeof(AudioUniforms));
+	if (dst == 0)
+		return;
+	memcpy(dst, &frame, sizeof(FrameUniforms));
+	memcpy(dst + _audioOffset, &_audio, sizeof(AudioUniforms));
+	size_t offset = _stream.Unmap();
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BINDING, _stream.Buffer(), offset, sizeof(FrameUniforms));
+	glBindBufferRange(GL_UNIFORM_BUFFER, AUDIO_BINDING, _stream.Buffer(), offset + _audioOffset, sizeof(AudioUniforms));
+}
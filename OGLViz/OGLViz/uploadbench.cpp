@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+#include <GL\\glew.h>
+
+#include "headers\\streambuffer.hpp"
+#include "headers\\uploadbench.hpp"
+
+enum UploadPath { PATH_BUFFER_DATA, PATH_SUB_DATA, PATH_UNSYNCHRONIZED, PATH_PERSISTENT, PATH_COUNT };
+
+static const char* pathNames[PATH_COUNT] = {
+	"glBufferData",
+	"orphan + glBufferSubData",
+	"StreamBuffer unsynchronized",
+	"StreamBuffer persistent",
+};
+
+// fill like Update would: the payload is generated on the CPU every frame
+static void fillPayload(char* dst, size_t size, int frame)
+{
+	float* f = (float*)dst;
+	size_t n = size / sizeof(float);
+	for (size_t i = 0; i < n; i++)
+		f[i] = (float)(i + frame);
+}
+
+// seconds for `frames` uploads of `size` bytes, -1 if the path is unavailable
+static double timePath(UploadPath path, size_t size, int frames, GLuint sink, std::vector<char>& staging,
+	unsigned& stalls)
+{
+	StreamBuffer stream;
+	GLuint buffer = 0;
+	if (path == PATH_UNSYNCHRONIZED || path == PATH_PERSISTENT) {
+		if (!stream.Init(GL_COPY_READ_BUFFER, size, 256, path == PATH_PERSISTENT))
+			return -1.0;
+		if (path == PATH_PERSISTENT && !stream.Persistent())
+			return -1.0;
+	}
+	else {
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glBufferData(GL_COPY_READ_BUFFER, size, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, sink);
+	glFinish();
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int frame = 0; frame < frames; frame++) {
+		GLintptr offset = 0;
+		switch (path) {
+		case PATH_BUFFER_DATA:
+			fillPayload(&staging[0], size, frame);
+			glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glBufferData(GL_COPY_READ_BUFFER, size, &staging[0], GL_STREAM_DRAW);
+			break;
+		case PATH_SUB_DATA:
+			fillPayload(&staging[0], size, frame);
+			glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glBufferData(GL_COPY_READ_BUFFER, size, NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_COPY_READ_BUFFER, 0, size, &staging[0]);
+			break;
+		default:
+		{
+			// a skipped upload still copies, from region 0, and counts in the busy column
+			char* p = (char*)stream.Map(size);
+			if (p != 0) {
+				fillPayload(p, size, frame);
+				offset = (GLintptr)stream.Unmap();
+			}
+			break;
+		}
+		}
+		// stands in for the draw that consumes the upload
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+		if (path == PATH_UNSYNCHRONIZED || path == PATH_PERSISTENT)
+			stream.Fence();
+	}
+	glFinish();
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	stalls = stream.Skips() + stream.Orphans();
+	glDeleteBuffers(1, &buffer);
+	return elapsed.count();
+}
+
+int runUploadBenchmark(int frames)
+{
+	static const size_t sizes[] = { 16 * 1024, 256 * 1024, 4 * 1024 * 1024 };
+	const int cSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+	fprintf(stdout, "%s\n%s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+	fprintf(stdout, "%d frames per run, each upload copied on the GPU\n\n", frames);
+	fprintf(stdout, "%-28s %10s %10s %8s\n", "path", "bytes", "MB/s", "busy");
+
+	GLuint sink;
+	glGenBuffers(1, &sink);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, sink);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizes[cSizes - 1], NULL, GL_STATIC_COPY);
+	std::vector<char> staging(sizes[cSizes - 1]);
+
+	for (int s = 0; s < cSizes; s++) {
+		for (int p = 0; p < PATH_COUNT; p++) {
+			unsigned stalls = 0;
+			double seconds = timePath((UploadPath)p, sizes[s], frames, sink, staging, stalls);
+			if (seconds < 0.0) {
+				fprintf(stdout, "%-28s %10u %10s\n", pathNames[p], (unsigned)sizes[s], "n/a");
+				continue;
+			}
+			double mbps = (double)sizes[s] * frames / (1024.0 * 1024.0) / seconds;
+			fprintf(stdout, "%-28s %10u %10.1f %8u\n", pathNames[p], (unsigned)sizes[s], mbps, stalls);
+		}
+		fprintf(stdout, "\n");
+	}
+
+	glDeleteBuffers(1, &sink);
+	return glGetError() == GL_NO_ERROR ? 0 : -1;
+}
@@ -84,12 +84,13 @@ struct PackedVertex {
 	};
 };
 
+template <typename Index>
 bool getSimilarVertexIndex_fast(
 	PackedVertex& packed,
-	std::map<PackedVertex, unsigned short>& VertexToOutIndex,
-	unsigned short& result
+	std::map<PackedVertex, Index>& VertexToOutIndex,
+	Index& result
 ) {
-	std::map<PackedVertex, unsigned short>::iterator it = VertexToOutIndex.find(packed);
+	typename std::map<PackedVertex, Index>::iterator it = VertexToOutIndex.find(packed);
 	if (it == VertexToOutIndex.end()) {
 		return false;
 	}
@@ -99,17 +100,18 @@ bool getSimilarVertexIndex_fast(
 	}
 }
 
-void indexVBO(
+template <typename Index>
+void indexVBO_impl(
 	std::vector<glm::vec3>& in_vertices,
 	std::vector<glm::vec2>& in_uvs,
 	std::vector<glm::vec3>& in_normals,
 
-	std::vector<unsigned short>& out_indices,
+	std::vector<Index>& out_indices,
 	std::vector<glm::vec3>& out_vertices,
 	std::vector<glm::vec2>& out_uvs,
 	std::vector<glm::vec3>& out_normals
 ) {
-	std::map<PackedVertex, unsigned short> VertexToOutIndex;
+	std::map<PackedVertex, Index> VertexToOutIndex;
 
 	// For each input vertex
 	for (unsigned int i = 0; i < in_vertices.size(); i++) {
@@ -118,7 +120,7 @@ void indexVBO(
 
 
 		// Try to find a similar vertex in out_XXXX
-		unsigned short index;
+		Index index;
 		bool found = getSimilarVertexIndex_fast(packed, VertexToOutIndex, index);
 
 		if (found) { // A similar vertex is already in the VBO, use it instead !
@@ -128,13 +130,39 @@ void indexVBO(
 			out_vertices.push_back(in_vertices[i]);
 			out_uvs.push_back(in_uvs[i]);
 			out_normals.push_back(in_normals[i]);
-			unsigned short newindex = (unsigned short)out_vertices.size() - 1;
+			Index newindex = (Index)(out_vertices.size() - 1);
 			out_indices.push_back(newindex);
 			VertexToOutIndex[packed] = newindex;
 		}
 	}
 }
 
+void indexVBO(
+	std::vector<glm::vec3>& in_vertices,
+	std::vector<glm::vec2>& in_uvs,
+	std::vector<glm::vec3>& in_normals,
+
+	std::vector<unsigned short>& out_indices,
+	std::vector<glm::vec3>& out_vertices,
+	std::vector<glm::vec2>& out_uvs,
+	std::vector<glm::vec3>& out_normals
+) {
+	indexVBO_impl(in_vertices, in_uvs, in_normals, out_indices, out_vertices, out_uvs, out_normals);
+}
+
+void indexVBO(
+	std::vector<glm::vec3>& in_vertices,
+	std::vector<glm::vec2>& in_uvs,
+	std::vector<glm::vec3>& in_normals,
+
+	std::vector<unsigned int>& out_indices,
+	std::vector<glm::vec3>& out_vertices,
+	std::vector<glm::vec2>& out_uvs,
+	std::vector<glm::vec3>& out_normals
+) {
+	indexVBO_impl(in_vertices, in_uvs, in_normals, out_indices, out_vertices, out_uvs, out_normals);
+}
+
 
 
 
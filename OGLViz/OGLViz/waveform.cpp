@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <vector>
+
+#include <GL\\glew.h>
+
+#include "headers\\shader.hpp"
+#include "headers\\renderstate.hpp"
+#include "headers\\trace.hpp"
+#include "headers\\waveform.hpp"
+
+// the recorder's 16-bit scale
+static const float FULL_SCALE = 32768.0f;
+// a trigger arms below -HYSTERESIS and fires rising through zero
+static const float TRIGGER_HYSTERESIS = 0.01f * FULL_SCALE;
+
+Waveform::Waveform()
+	: _program(0), _vao(0), _texture(0), _rectID(-1), _columnsID(-1), _windowID(-1), _firstID(-1), _levelID(-1),
+	_levelRowID(-1), _levelMaskID(-1), _rowWidthID(-1), _gainID(-1), _pixelHeightID(-1), _capacity(0),
+	_levelCount(0), _written(0), _uploadedEntries(0), _window(0), _triggered(false), _level(0), _triggers(0),
+	_triggeredDraws(0)
+{
+	for (int k = 0; k < MAX_LEVELS; k++) {
+		_rowStart[k] = 0;
+		_uploaded[k] = 0;
+	}
+}
+
+Waveform::~Waveform()
+{
+	glDeleteTextures(1, &_texture);
+	glDeleteVertexArrays(1, &_vao);
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+}
+
+bool Waveform::Init(int capacity, const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	GLuint program = LoadShaders(vertexShaderPath, fragmentShaderPath);
+	if (program == 0)
+		return false;
+	SetProgram(program);
+
+	// a power of 2 so every level is a whole ring and entries never straddle the seam
+	_capacity = ROW;
+	while (_capacity < capacity && _capacity < (1 << (MAX_LEVELS - 1)))
+		_capacity *= 2;
+	// levels down to a single entry
+	_levelCount = 0;
+	int rows = 0;
+	for (int entries = _capacity; entries >= 1; entries /= 2) {
+		_rowStart[_levelCount] = rows;
+		rows += entries > ROW ? entries / ROW : 1;
+		_levels[_levelCount].assign(2 * entries, 0.0f);
+		_levelCount++;
+	}
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (rows > maxSize) {
+		fprintf(stderr, "Waveform pyramid needs %d texture rows, the limit is %d\n", rows, maxSize);
+		return false;
+	}
+
+	// history starts silent
+	std::vector<float> silence((size_t)ROW * rows * 2, 0.0f);
+	glGenTextures(1, &_texture);
+	glState().BindTexture(0, _texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, ROW, rows, 0, GL_RG, GL_FLOAT, &silence[0]);
+	// texelFetch only
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// the column quads come from gl_VertexID and gl_InstanceID, the VAO is only there for core profile
+	glGenVertexArrays(1, &_vao);
+	return glGetError() == GL_NO_ERROR;
+}
+
+void Waveform::SetProgram(GLuint program)
+{
+	glState().ForgetProgram(_program);
+	glDeleteProgram(_program);
+	_program = program;
+	_rectID = glGetUniformLocation(_program, "rect");
+	_columnsID = glGetUniformLocation(_program, "columns");
+	_windowID = glGetUniformLocation(_program, "window");
+	_firstID = glGetUniformLocation(_program, "first");
+	_levelID = glGetUniformLocation(_program, "level");
+	_levelRowID = glGetUniformLocation(_program, "levelRow");
+	_levelMaskID = glGetUniformLocation(_program, "levelMask");
+	_rowWidthID = glGetUniformLocation(_program, "rowWidth");
+	_gainID = glGetUniformLocation(_program, "gain");
+	_pixelHeightID = glGetUniformLocation(_program, "pixelHeight");
+}
+
+void Waveform::SetWindow(int samples, bool triggered)
+{
+	int limit = triggered ? _capacity / 2 : _capacity;
+	_window = samples < 1 ? 1 : (samples > limit ? limit : samples);
+	_triggered = triggered;
+}
+
+void Waveform::Append(const float* samples, int count)
+{
+	TRACE_SCOPE("Waveform::Append");
+	uint64_t mask = (uint64_t)_capacity - 1;
+	for (int s = 0; s < count; s++) {
+		float* entry = &_levels[0][2 * (_written & mask)];
+		entry[0] = entry[1] = samples[s];
+		uint64_t n = ++_written;
+		// every 2^k samples completes entry n / 2^k - 1 of level k, from its two children
+		for (int k = 1; k < _levelCount && (n & ((1ull << k) - 1)) == 0; k++) {
+			uint64_t q = (n >> k) - 1;
+			uint64_t childMask = mask >> (k - 1);
+			const float* a = &_levels[k - 1][2 * ((2 * q) & childMask)];
+			const float* b = &_levels[k - 1][2 * ((2 * q + 1) & childMask)];
+			float* parent = &_levels[k][2 * (q & (mask >> k))];
+			parent[0] = a[0] < b[0] ? a[0] : b[0];
+			parent[1] = a[1] > b[1] ? a[1] : b[1];
+		}
+	}
+}
+
+void Waveform::Upload(int level)
+{
+	int entries = _capacity >> level;
+	int rowWidth = entries < ROW ? entries : ROW;
+	uint64_t produced = _written >> level;
+	uint64_t e = _uploaded[level];
+	// anything older than a ring's worth has been overwritten already
+	if (produced - e > (uint64_t)entries)
+		e = produced - entries;
+	if (e == produced)
+		return;
+	glState().BindTexture(0, _texture);
+	while (e < produced) {
+		int index = (int)(e & (uint64_t)(entries - 1));
+		int x = index % rowWidth;
+		int length = rowWidth - x;
+		if ((uint64_t)length > produced - e)
+			length = (int)(produced - e);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, _rowStart[level] + index / rowWidth, length, 1, GL_RG, GL_FLOAT,
+			&_levels[level][2 * index]);
+		e += length;
+		_uploadedEntries += length;
+	}
+	_uploaded[level] = produced;
+}
+
+// last rising zero crossing starting in [earliest, latest], armed by a dip below -hysteresis
+int64_t Waveform::FindTrigger(int64_t earliest, int64_t latest) const
+{
+	const std::vector<float>& samples = _levels[0];
+	int64_t mask = _capacity - 1;
+	int64_t found = -1;
+	bool armed = false;
+	for (int64_t t = earliest; t <= latest; t++) {
+		float value = samples[2 * (t & mask)];
+		if (value < -TRIGGER_HYSTERESIS)
+			armed = true;
+		else if (armed && value >= 0.0f && t > earliest) {
+			found = t;
+			armed = false;
+		}
+	}
+	return found;
+}
+
+void Waveform::Draw(float left, float bottom, float right, float top, int width, int height)
+{
+	TRACE_SCOPE("Waveform::Draw");
+	int columns = (int)((right - left) * 0.5f * width + 0.5f);
+	if (_window <= 0 || columns < 1 || _written == 0)
+		return;
+
+	// coarsest level that still has an entry for every column
+	int level = 0;
+	while (level + 1 < _levelCount && (_window >> (level + 1)) >= columns)
+		level++;
+	_level = level;
+	Upload(level);
+
+	// only whole entries: the newest partial one is not in the pyramid yet
+	int64_t end = (int64_t)((_written >> level) << level);
+	int64_t first = end - _window;
+	if (_triggered) {
+		_triggeredDraws++;
+		// one window of search, and the entry holding the start must not be overwritten yet
+		int64_t earliest = first - _window;
+		int64_t oldest = end - _capacity + (1ll << level);
+		earliest = earliest > oldest ? earliest : oldest;
+		earliest = earliest > 1 ? earliest : 1;
+		int64_t trigger = earliest < first ? FindTrigger(earliest, first) : -1;
+		if (trigger >= 0) {
+			first = trigger;
+			_triggers++;
+		}
+	}
+
+	glState().UseProgram(_program);
+	glState().Uniform4f(_rectID, left, bottom, right, top);
+	glState().Uniform1i(_columnsID, columns);
+	glState().Uniform1i(_windowID, _window);
+	// ring position: the shader only needs it modulo the capacity
+	glState().Uniform1i(_firstID, (int)(first & (_capacity - 1)));
+	glState().Uniform1i(_levelID, level);
+	glState().Uniform1i(_levelRowID, _rowStart[level]);
+	glState().Uniform1i(_levelMaskID, (_capacity >> level) - 1);
+	glState().Uniform1i(_rowWidthID, (_capacity >> level) < ROW ? (_capacity >> level) : ROW);
+	glState().Uniform1f(_gainID, 1.0f / FULL_SCALE);
+	glState().Uniform1f(_pixelHeightID, height > 0 ? 2.0f / height : 0.0f);
+	glState().BindTexture(0, _texture);
+	glState().BindVertexArray(_vao);
+	glState().Set(RenderState::DEPTH_TEST, false);
+	glState().Set(RenderState::BLEND, false);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, columns);
+}